@@ -56,6 +56,8 @@ class WithoutEventCallbacks
 public:
     using options = typename get_options<TDerived>::type;
     using event_type = typename options::event_type;
+    using event_argument_type
+        = typename get_event_argument_type<options>::type;
 
     template <typename TType>
     void setEventDispatchCallback(TType&&)
@@ -73,12 +75,12 @@ public:
 
 protected:
     inline
-    void invokeEventDispatchCallback(event_type)
+    void invokeEventDispatchCallback(const event_type&)
     {
     }
 
     inline
-    void invokeEventDiscardedCallback(event_type)
+    void invokeEventDiscardedCallback(const event_type&)
     {
     }
 };
@@ -89,6 +91,8 @@ class WithEventCallbacks
 public:
     using options = typename get_options<TDerived>::type;
     using event_type = typename options::event_type;
+    using event_argument_type
+        = typename get_event_argument_type<options>::type;
 
     template <typename TType>
     void setEventDispatchCallback(TType&& callback)
@@ -104,22 +108,22 @@ public:
 
 protected:
     inline
-    void invokeEventDispatchCallback(event_type event)
+    void invokeEventDispatchCallback(const event_type& event)
     {
         if (m_eventDispatchCallback)
             m_eventDispatchCallback(event);
     }
 
     inline
-    void invokeEventDiscardedCallback(event_type event)
+    void invokeEventDiscardedCallback(const event_type& event)
     {
         if (m_eventDiscardedCallback)
             m_eventDiscardedCallback(event);
     }
 
 private:
-    std::function<void(event_type)> m_eventDispatchCallback;
-    std::function<void(event_type)> m_eventDiscardedCallback;
+    std::function<void(event_argument_type)> m_eventDispatchCallback;
+    std::function<void(event_argument_type)> m_eventDiscardedCallback;
 };
 
 template <bool TEnabled, typename TOptions>
@@ -30,30 +30,77 @@
 #define FSM11_DETAIL_EVENTDISPATCHER_HPP
 
 #include "../statemachine_fwd.hpp"
+#include "../executor.hpp"
 #include "../historystate.hpp"
 #include "scopeguard.hpp"
+#include "statetable.hpp"
+#include "timerservice.hpp"
 
 #ifdef FSM11_USE_WEOS
 #include <weos/atomic.hpp>
 #include <weos/condition_variable.hpp>
 #include <weos/future.hpp>
+#include <weos/initializer_list.hpp>
 #include <weos/mutex.hpp>
 #include <weos/utility.hpp>
+#include <weos/type_traits.hpp>
 #include <weos/thread.hpp>
 #else
 #include <atomic>
 #include <condition_variable>
 #include <future>
+#include <initializer_list>
 #include <mutex>
 #include <utility>
+#include <type_traits>
 #include <thread>
 #endif // FSM11_USE_WEOS
 
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
 namespace fsm11
 {
 namespace fsm11_detail
 {
 
+// ----=====================================================================----
+//     Event list helpers
+// ----=====================================================================----
+
+//! Appends the \p event to the \p list. Returns the result of the list's
+//! \p push_back(), if it reports whether the event has been accepted.
+template <typename TList, typename TEvent>
+auto pushToEventList(TList& list, TEvent&& event, int)
+    -> decltype(bool(list.push_back(std::forward<TEvent>(event))))
+{
+    return list.push_back(std::forward<TEvent>(event));
+}
+
+//! Appends the \p event to the \p list, which always accepts it.
+template <typename TList, typename TEvent>
+bool pushToEventList(TList& list, TEvent&& event, long)
+{
+    list.push_back(std::forward<TEvent>(event));
+    return true;
+}
+
+//! Checks if adding an event to a full event list of type \p TList has to
+//! block the producer. Such a list has to define a static member
+//! \p block_when_full, which is \p true, and a member function \p full().
+template <typename TList, typename TEnable = void>
+struct is_blocking_event_list : public std::false_type
+{
+};
+
+template <typename TList>
+struct is_blocking_event_list<
+        TList, typename std::enable_if<TList::block_when_full>::type>
+    : public std::true_type
+{
+};
+
 // ----=====================================================================----
 //     EventDispatcherBase
 // ----=====================================================================----
@@ -64,7 +111,8 @@ class EventDispatcherBase
 public:
     EventDispatcherBase() noexcept
         : m_enabledTransitions(nullptr),
-          m_numConfigurationChanges(0)
+          m_numConfigurationChanges(0),
+          m_nextInternalEvent(0)
     {
     }
 
@@ -73,11 +121,26 @@ public:
         return m_numConfigurationChanges;
     }
 
+    //! \brief Raises an internal event.
+    //!
+    //! Appends the \p event to the internal event queue. The internal
+    //! events are dispatched after the eventless transitions of the current
+    //! macrostep and before the next event from the event list. In contrast
+    //! to addEvent(), no lock is taken. So this function must only be
+    //! called from within the state machine, i.e. from an action, a guard
+    //! or the entry or exit function of a state.
+    void raise(typename get_options<TDerived>::type::event_type event)
+    {
+        m_internalEvents.push_back(std::move(event));
+    }
+
 protected:
     using options = typename get_options<TDerived>::type;
     using event_type = typename options::event_type;
     using state_type = State<TDerived>;
     using transition_type = Transition<TDerived>;
+    using state_table_type = StateTable<TDerived>;
+    using index_type = typename state_table_type::index_type;
 
 
     //! The set of enabled transitions.
@@ -85,6 +148,39 @@ protected:
 
     std::atomic_uint m_numConfigurationChanges;
 
+    //! The flat representation of the state hierarchy.
+    state_table_type m_stateTable;
+
+    //! The indices of the active states without an active child sorted in
+    //! document order. In a legal configuration, these are the active
+    //! atomic states. Together with their ancestors, they form the
+    //! active configuration.
+    std::vector<index_type> m_activeLeaves;
+
+    //! A scratch buffer for state indices.
+    std::vector<index_type> m_stateBuffer;
+
+    //! The indices of the states, whose transient flags have been set
+    //! since the last call to clearTransientStateFlags().
+    std::vector<index_type> m_touchedStates;
+
+    //! The states, which have been entered or left since the visible
+    //! active flags have been synchronized. Pointers are kept because the
+    //! state table might be rebuilt in the meantime.
+    std::vector<state_type*> m_changedStates;
+
+    //! The pool of the static entry sets of the transitions.
+    std::vector<index_type> m_entryStates;
+
+    //! Marks the states of an entry set during its computation. All
+    //! elements are zero outside of computeStaticEntrySet().
+    std::vector<char> m_entryMarks;
+
+    //! The internal event queue and the position of the next internal
+    //! event. The queue is only accessed while dispatching.
+    std::vector<event_type> m_internalEvents;
+    std::size_t m_nextInternalEvent;
+
 
     TDerived& derived()
     {
@@ -96,6 +192,51 @@ protected:
         return *static_cast<const TDerived*>(this);
     }
 
+    template <typename T>
+    friend struct StateTableLookup;
+
+
+    //! Marks the state table as outdated.
+    void invalidateStateTable() noexcept
+    {
+        m_stateTable.invalidate();
+    }
+
+    //! Rebuilds the state table, if the hierarchy or the transitions have
+    //! changed since it has been built.
+    void updateStateTable();
+
+    //! Recomputes the active leaves from the active flags.
+    void rebuildActiveLeaves();
+
+    //! Updates the active leaves after the state \p idx has been entered.
+    void addActiveLeaf(index_type idx);
+
+    //! Updates the active leaves after the state \p idx has been left.
+    void removeActiveLeaf(index_type idx);
+
+    //! Appends the indices of all active states to the \p result in
+    //! post-order.
+    void collectActiveStatesInPostOrder(std::vector<index_type>& result) const;
+
+    //! Appends the \p event to the event list and returns \p true, if the
+    //! list has accepted it. The caller has to hold the lock protecting the
+    //! list.
+    template <typename TEvent>
+    bool pushEvent(TEvent&& event)
+    {
+        return pushToEventList(derived().m_eventList,
+                               std::forward<TEvent>(event), 0);
+    }
+
+    //! Appends the events in the range <tt>[first, last)</tt> to the event
+    //! list. The caller has to hold the lock protecting the list.
+    template <typename TInputIterator>
+    void pushEvents(TInputIterator first, TInputIterator last)
+    {
+        for (; first != last; ++first)
+            pushEvent(*first);
+    }
 
     //! Resets the history states.
     void resetHistoryStates() noexcept;
@@ -109,12 +250,33 @@ protected:
     //! criteria. If \p onlyEventless is set, only transitions without events
     //! are selected. Otherwise, a transition is selected, if it's trigger event
     //! equals the given \p event.
-    void selectTransitions(bool onlyEventless, event_type event);
+    void selectTransitions(bool onlyEventless, const event_type& event);
 
     //! Computes the transition domain of the given \p transition.
     static state_type* transitionDomain(const transition_type* transition);
 
-    //! Clears the transient flags of all states.
+    //! Computes the domain and the static entry set of the \p transition
+    //! unless they have been cached for the current state table.
+    void updateTransitionCache(transition_type* transition);
+
+    //! \brief Computes a static entry set.
+    //!
+    //! Appends the states below the \p domain, which are entered when the
+    //! \p target is entered, to the entry state pool in document order. The
+    //! return value is \p false, if the entry set depends on a history
+    //! state. In this case, nothing is appended.
+    bool computeStaticEntrySet(index_type domain, index_type target);
+
+    //! Sets the transient \p flags of the \p state and records the state
+    //! in the list of touched states.
+    void setTransientFlags(state_type* state, int flags)
+    {
+        if (!(state->m_flags & state_type::Transient))
+            m_touchedStates.push_back(state->m_index);
+        state->m_flags |= flags;
+    }
+
+    //! Clears the transient flags of all touched states.
     void clearTransientStateFlags() noexcept;
 
     //! \brief Propagates the entry mark to all descendant states.
@@ -126,17 +288,32 @@ protected:
     void markDescendantsForEntry();
 
     //! Enters all states in the enter-set.
-    void enterStatesInEnterSet(event_type event);
+    void enterStatesInEnterSet(const event_type& event);
 
     //! Leaves all states in the exit-set.
-    void leaveStatesInExitSet(event_type event);
+    void leaveStatesInExitSet(const event_type& event);
+
+    //! \brief Dispatches an event.
+    //!
+    //! Selects the transitions, which are enabled by the \p event, and
+    //! performs a microstep. If no transition is enabled, the event is
+    //! discarded. The return value is \p true, if the configuration has
+    //! been changed.
+    bool dispatchEvent(const event_type& event);
+
+    //! \brief Dispatches a timeout.
+    //!
+    //! Performs a microstep with the timeout \p transition, if the timer
+    //! with the given \p generation is not outdated and the guard holds.
+    //! The return value is \p true, if the configuration has been changed.
+    bool dispatchTimeout(transition_type* transition, std::uint32_t generation);
 
     //! \brief Performs a microstep.
     //!
     //! Performs a microstep. The given \p event is passed to the onEntry()
     //! and onExit() functions. The return value is \p true, if the
     //! configuration has been changed.
-    bool microstep(event_type event);
+    bool microstep(const event_type& event);
 
     //! Follows all eventless transitions. Invokes the configuration change
     //! callback, if either \p changedConfiguration is set or at least one
@@ -144,8 +321,32 @@ protected:
     //! configuration.
     void runToCompletion(bool changedConfiguration);
 
-    //! Finds a transition conflict.
-    void findTransitionConflict(transition_type* ignoredTransition);
+    //! \brief Checks if the exit sets of two transitions overlap.
+    //!
+    //! The exit set of a transition consists of the active proper
+    //! descendants of its domain. As the domain is active, the exit sets
+    //! of the transitions \p t1 and \p t2 overlap if and only if one
+    //! domain is an ancestor of the other one. This is a static relation,
+    //! which is answered in constant time from the sub-tree intervals.
+    bool exitSetsOverlap(const transition_type* t1,
+                         const transition_type* t2) const noexcept
+    {
+        index_type d1 = t1->m_domain->m_index;
+        index_type d2 = t2->m_domain->m_index;
+        return m_stateTable.isAncestor(d1, d2)
+               || m_stateTable.isAncestor(d2, d1);
+    }
+
+    //! Returns the first transition in the enabled set preceding the
+    //! \p transition, whose exit set overlaps with the one of the
+    //! \p transition. If there is no such transition, a null-pointer is
+    //! returned.
+    transition_type* findConflictingTransition(
+            const transition_type* transition) const noexcept;
+
+    //! Sets the \p flags of all active states in the sub-tree rooted at
+    //! \p domain (excluding the domain itself).
+    void markActiveProperDescendants(const state_type* domain, int flags);
 
     //! Enters the initial states and thus brings up the state machine.
     void enterInitialStates();
@@ -155,18 +356,114 @@ protected:
     void leaveConfiguration();
 };
 
+template <typename TDerived>
+void EventDispatcherBase<TDerived>::updateStateTable()
+{
+    if (!m_stateTable.valid())
+    {
+        m_stateTable.build(derived());
+        rebuildActiveLeaves();
+        m_entryStates.clear();
+        m_entryMarks.assign(m_stateTable.size(), 0);
+
+        // The indices of the touched states are outdated.
+        for (index_type idx = 0; idx < m_stateTable.size(); ++idx)
+            m_stateTable.state(idx)->m_flags &= ~state_type::Transient;
+        m_touchedStates.clear();
+    }
+}
+
+template <typename TDerived>
+void EventDispatcherBase<TDerived>::rebuildActiveLeaves()
+{
+    m_activeLeaves.clear();
+    for (index_type idx = 0; idx < m_stateTable.size(); ++idx)
+    {
+        if (!(m_stateTable.state(idx)->m_flags & state_type::Active))
+            continue;
+
+        // The parent precedes its children. So if the parent has been
+        // added as a leaf, it is the last element.
+        index_type parent = m_stateTable.parent(idx);
+        if (!m_activeLeaves.empty() && m_activeLeaves.back() == parent)
+            m_activeLeaves.pop_back();
+        m_activeLeaves.push_back(idx);
+    }
+}
+
+template <typename TDerived>
+void EventDispatcherBase<TDerived>::addActiveLeaf(index_type idx)
+{
+    auto iter = std::lower_bound(m_activeLeaves.begin(), m_activeLeaves.end(),
+                                 idx);
+    // The parent has an active child now. It is the leaf right before
+    // the new one.
+    index_type parent = m_stateTable.parent(idx);
+    if (iter != m_activeLeaves.begin() && *(iter - 1) == parent)
+        *(iter - 1) = idx;
+    else
+        m_activeLeaves.insert(iter, idx);
+}
+
+template <typename TDerived>
+void EventDispatcherBase<TDerived>::removeActiveLeaf(index_type idx)
+{
+    auto iter = std::lower_bound(m_activeLeaves.begin(), m_activeLeaves.end(),
+                                 idx);
+    if (iter == m_activeLeaves.end() || *iter != idx)
+        return;
+
+    // If the parent is still active but has no active child any more, it
+    // becomes a leaf. The neighbouring leaves tell if the parent has
+    // another active descendant.
+    index_type parent = m_stateTable.parent(idx);
+    if (parent != state_table_type::npos
+        && (m_stateTable.state(parent)->m_flags & state_type::Active)
+        && (iter == m_activeLeaves.begin() || *(iter - 1) < parent)
+        && (iter + 1 == m_activeLeaves.end()
+            || *(iter + 1) >= m_stateTable.subtreeEnd(parent)))
+    {
+        *iter = parent;
+    }
+    else
+    {
+        m_activeLeaves.erase(iter);
+    }
+}
+
+template <typename TDerived>
+void EventDispatcherBase<TDerived>::collectActiveStatesInPostOrder(
+        std::vector<index_type>& result) const
+{
+    // Every leaf is followed by those ancestors, which do not contain the
+    // next leaf. This is exactly the post-order of the active states.
+    for (std::size_t leaf = 0; leaf < m_activeLeaves.size(); ++leaf)
+    {
+        index_type next = leaf + 1 < m_activeLeaves.size()
+                          ? m_activeLeaves[leaf + 1]
+                          : state_table_type::npos;
+        index_type idx = m_activeLeaves[leaf];
+        do
+        {
+            result.push_back(idx);
+            idx = m_stateTable.parent(idx);
+        } while (idx != state_table_type::npos
+                 && m_stateTable.subtreeEnd(idx) <= next);
+    }
+}
+
 template <typename TDerived>
 void EventDispatcherBase<TDerived>::resetHistoryStates() noexcept
 {
-    for (auto iter = derived().pre_order_begin();
-         iter != derived().pre_order_end(); ++iter)
+    for (index_type idx = 0; idx < m_stateTable.size(); ++idx)
     {
-        if (iter->m_flags
+        state_type* state = m_stateTable.state(idx);
+        if (state->m_flags
             & (state_type::ShallowHistory | state_type::DeepHistory))
         {
             using history_state_type = ShallowHistoryState<TDerived>;
             history_state_type* historyState
-                    = static_cast<history_state_type*>(&*iter);
+                    = static_cast<history_state_type*>(state);
             historyState->m_latestActiveChild = nullptr;
         }
     }
@@ -187,35 +484,43 @@ void EventDispatcherBase<TDerived>::clearEnabledTransitionsSet() noexcept
 
 template <typename TDerived>
 void EventDispatcherBase<TDerived>::selectTransitions(bool onlyEventless,
-                                                      event_type event)
+                                                      const event_type& event)
 {
     transition_type** outputIter = &m_enabledTransitions;
 
-    // Loop over the states in post-order. This way, the descendent states are
-    // checked before their ancestors.
-    for (auto stateIter = derived().post_order_begin();
-         stateIter != derived().post_order_end(); ++stateIter)
+    // Loop over the active states in post-order. This way, the descendent
+    // states are checked before their ancestors.
+    m_stateBuffer.clear();
+    collectActiveStatesInPostOrder(m_stateBuffer);
+    for (index_type idx : m_stateBuffer)
     {
-        if (!(stateIter->m_flags & state_type::Active))
-            continue;
+        state_type* state = m_stateTable.state(idx);
 
         // If a transition in a descendant of a parallel state has already
         // been selected, the parallel state itself and all its ancestors
         // can be skipped.
-        if (stateIter->m_flags & state_type::SkipTransitionSelection)
+        if (state->m_flags & state_type::SkipTransitionSelection)
+            continue;
+
+        if (onlyEventless && !m_stateTable.hasEventlessTransitions(idx))
             continue;
 
+        // Only the transitions which are eventless or whose event matches
+        // have to be considered. They are looked up in the event index.
+        auto candidates = onlyEventless
+                          ? m_stateTable.eventlessTransitions(idx)
+                          : m_stateTable.candidateTransitions(idx, event);
+
         bool foundTransition = false;
-        for (auto transitionIter = stateIter->beginTransitions();
-             transitionIter != stateIter->endTransitions(); ++transitionIter)
+        for (auto transitionIter = candidates.first;
+             transitionIter != candidates.second; ++transitionIter)
         {
-            // Skip transitions with events in microstepping mode.
-            if (onlyEventless && !transitionIter->eventless())
-                continue;
+            transition_type* transition = *transitionIter;
 
-            // If a transition has an event, the event must match.
-            if (!transitionIter->eventless()
-                && transitionIter->event() != event)
+            // If the index cannot map events, the event must be compared.
+            if (!state_table_type::exact_event_match
+                && !transition->eventless()
+                && !state_table_type::eventMatches(transition->event(), event))
             {
                 continue;
             }
@@ -223,10 +528,10 @@ void EventDispatcherBase<TDerived>::selectTransitions(bool onlyEventless,
             // If the transition has a guard, it must evaluate to true in order
             // to select the transition. A transition without guard is selected
             // unconditionally.
-            if (!transitionIter->guard() || transitionIter->guard()(event))
+            if (!transition->guard() || transition->guard()(event))
             {
-                *outputIter = &*transitionIter;
-                outputIter = &transitionIter->m_nextInEnabledSet;
+                *outputIter = transition;
+                outputIter = &transition->m_nextInEnabledSet;
                 foundTransition = true;
 
                 // When the transition selection shall stop after the first
@@ -242,12 +547,13 @@ void EventDispatcherBase<TDerived>::selectTransitions(bool onlyEventless,
             // As we have found a transition in this state, there is no need to
             // check the ancestors for a matching transition.
             bool hasParallelAncestor = false;
-            state_type* ancestor = stateIter->parent();
-            while (ancestor)
+            for (index_type ancestor = m_stateTable.parent(idx);
+                 ancestor != state_table_type::npos;
+                 ancestor = m_stateTable.parent(ancestor))
             {
-                ancestor->m_flags |= state_type::SkipTransitionSelection;
-                hasParallelAncestor |= ancestor->isParallel();
-                ancestor = ancestor->parent();
+                setTransientFlags(m_stateTable.state(ancestor),
+                                  state_type::SkipTransitionSelection);
+                hasParallelAncestor |= m_stateTable.isParallel(ancestor);
             }
 
             // If none of the ancestors is a parallel state, there is no
@@ -276,30 +582,142 @@ auto EventDispatcherBase<TDerived>::transitionDomain(
                                          transition->target());
 }
 
+template <typename TDerived>
+void EventDispatcherBase<TDerived>::updateTransitionCache(
+        transition_type* transition)
+{
+    if (transition->m_cacheGeneration == m_stateTable.generation())
+        return;
+
+    state_type* domain = transitionDomain(transition);
+    transition->m_domain = domain;
+    transition->m_firstEntryState = index_type(m_entryStates.size());
+    transition->m_hasStaticEntrySet
+            = domain != nullptr
+              && computeStaticEntrySet(domain->m_index,
+                                       transition->target()->m_index);
+    transition->m_lastEntryState = index_type(m_entryStates.size());
+    transition->m_cacheGeneration = m_stateTable.generation();
+}
+
+template <typename TDerived>
+bool EventDispatcherBase<TDerived>::computeStaticEntrySet(index_type domain,
+                                                          index_type target)
+{
+    std::size_t first = m_entryStates.size();
+    auto mark = [&](index_type idx) {
+        if (!m_entryMarks[idx])
+        {
+            m_entryMarks[idx] = 1;
+            m_entryStates.push_back(idx);
+        }
+    };
+
+    // Mark the path from the target up to the domain.
+    for (index_type idx = target; idx != domain; idx = m_stateTable.parent(idx))
+        mark(idx);
+
+    // Expand the marked states like markDescendantsForEntry() does.
+    bool isStatic = true;
+    index_type idx = domain + 1;
+    index_type end = m_stateTable.subtreeEnd(domain);
+    while (idx < end)
+    {
+        if (!m_entryMarks[idx])
+        {
+            idx = m_stateTable.subtreeEnd(idx);
+            continue;
+        }
+
+        if (m_stateTable.isCompound(idx))
+        {
+            bool childMarked = false;
+            for (index_type child = idx + 1;
+                 child < m_stateTable.subtreeEnd(idx);
+                 child = m_stateTable.subtreeEnd(child))
+            {
+                if (m_entryMarks[child])
+                {
+                    childMarked = true;
+                    break;
+                }
+            }
+
+            if (!childMarked)
+            {
+                state_type* state = m_stateTable.state(idx);
+                if (state->m_flags
+                    & (state_type::ShallowHistory | state_type::DeepHistory))
+                {
+                    isStatic = false;
+                    break;
+                }
+
+                if (state_type* initialState = state->initialState())
+                {
+                    for (index_type chain = initialState->m_index;
+                         chain != idx; chain = m_stateTable.parent(chain))
+                    {
+                        mark(chain);
+                    }
+                }
+                else
+                {
+                    // The first child follows its parent in pre-order.
+                    mark(idx + 1);
+                }
+            }
+        }
+        else if (m_stateTable.isParallel(idx))
+        {
+            for (index_type child = idx + 1;
+                 child < m_stateTable.subtreeEnd(idx);
+                 child = m_stateTable.subtreeEnd(child))
+            {
+                mark(child);
+            }
+        }
+
+        ++idx;
+    }
+
+    for (std::size_t pos = first; pos < m_entryStates.size(); ++pos)
+        m_entryMarks[m_entryStates[pos]] = 0;
+
+    if (isStatic)
+        std::sort(m_entryStates.begin() + first, m_entryStates.end());
+    else
+        m_entryStates.resize(first);
+    return isStatic;
+}
+
 template <typename TDerived>
 void EventDispatcherBase<TDerived>::clearTransientStateFlags() noexcept
 {
-    for (auto iter = derived().begin(); iter != derived().end(); ++iter)
-        iter->m_flags &= ~state_type::Transient;
+    for (index_type idx : m_touchedStates)
+        m_stateTable.state(idx)->m_flags &= ~state_type::Transient;
+    m_touchedStates.clear();
 }
 
 template <typename TDerived>
 void EventDispatcherBase<TDerived>::markDescendantsForEntry()
 {
-    for (auto state = derived().begin(); state != derived().end(); ++state)
+    index_type idx = 0;
+    while (idx < m_stateTable.size())
     {
+        state_type* state = m_stateTable.state(idx);
         if (!(state->m_flags & state_type::InEnterSet))
         {
-            state.skipChildren();
+            idx = m_stateTable.subtreeEnd(idx);
             continue;
         }
 
-        if (state->isCompound())
+        if (m_stateTable.isCompound(idx))
         {
             // Exactly one state of a compound state has to be marked for entry.
             bool childMarked = false;
-            for (auto child = state.child_begin();
-                 child != state.child_end(); ++child)
+            for (auto child = state->child_begin();
+                 child != state->child_end(); ++child)
             {
                 if (child->m_flags & state_type::InEnterSet)
                 {
@@ -315,11 +733,13 @@ void EventDispatcherBase<TDerived>::markDescendantsForEntry()
                 {
                     using history_state_type = ShallowHistoryState<TDerived>;
                     history_state_type* historyState
-                            = static_cast<history_state_type*>(&*state);
+                            = static_cast<history_state_type*>(state);
 
                     if (historyState->m_latestActiveChild)
                     {
-                        historyState->m_latestActiveChild->m_flags |= state_type::InEnterSet;
+                        setTransientFlags(historyState->m_latestActiveChild,
+                                          state_type::InEnterSet);
+                        ++idx;
                         continue;
                     }
                 }
@@ -328,60 +748,85 @@ void EventDispatcherBase<TDerived>::markDescendantsForEntry()
                 {
                     do
                     {
-                        initialState->m_flags |= state_type::InEnterSet;
+                        setTransientFlags(initialState, state_type::InEnterSet);
                         initialState = initialState->parent();
-                    } while (initialState != &*state);
+                    } while (initialState != state);
                 }
                 else
                 {
-                    state->m_children->m_flags |= state_type::InEnterSet;
+                    setTransientFlags(state->m_children, state_type::InEnterSet);
                 }
             }
         }
-        else if (state->isParallel())
+        else if (m_stateTable.isParallel(idx))
         {
             // All child states of a parallel state have to be marked for entry.
-            for (auto child = state.child_begin();
-                 child != state.child_end(); ++child)
+            for (auto child = state->child_begin();
+                 child != state->child_end(); ++child)
             {
-                child->m_flags |= state_type::InEnterSet;
+                setTransientFlags(&*child, state_type::InEnterSet);
             }
         }
+
+        ++idx;
     }
 }
 
 template <typename TDerived>
-void EventDispatcherBase<TDerived>::enterStatesInEnterSet(event_type event)
+void EventDispatcherBase<TDerived>::enterStatesInEnterSet(const event_type& event)
 {
-    for (auto iter = derived().begin(); iter != derived().end(); ++iter)
+    // The enter set is a subset of the touched states. Sort it into
+    // document order.
+    m_stateBuffer.clear();
+    for (index_type idx : m_touchedStates)
+    {
+        if (m_stateTable.state(idx)->m_flags & state_type::InEnterSet)
+            m_stateBuffer.push_back(idx);
+    }
+    std::sort(m_stateBuffer.begin(), m_stateBuffer.end());
+
+    for (index_type idx : m_stateBuffer)
     {
-        if ((iter->m_flags & state_type::InEnterSet)
-            && !(iter->m_flags & state_type::Active))
+        state_type* state = m_stateTable.state(idx);
+        if ((state->m_flags & state_type::InEnterSet)
+            && !(state->m_flags & state_type::Active))
         {
-            derived().invokeStateEntryCallback(&*iter);
+            derived().invokeStateEntryCallback(state);
             try
             {
-                iter->onEntry(event);
+                state->onEntry(event);
             }
             catch (...)
             {
                 derived().invokeStateExceptionCallbackOrThrow();
             }
-            iter->m_flags |= (state_type::Active | state_type::StartInvoke);
+            state->m_flags |= (state_type::Active | state_type::StartInvoke);
+            addActiveLeaf(idx);
+            m_changedStates.push_back(state);
+
+            if (m_stateTable.hasTimeoutTransitions(idx))
+            {
+                auto timeouts = m_stateTable.timeoutTransitions(idx);
+                for (auto iter = timeouts.first; iter != timeouts.second; ++iter)
+                    derived().armTimeout(*iter);
+            }
         }
     }
 }
 
 template <typename TDerived>
-void EventDispatcherBase<TDerived>::leaveStatesInExitSet(event_type event)
+void EventDispatcherBase<TDerived>::leaveStatesInExitSet(const event_type& event)
 {
-    for (auto atomicState = derived().atomic_begin();
-         atomicState != derived().atomic_end(); ++atomicState)
+    // Only active states can be in the exit set.
+    for (index_type idx : m_activeLeaves)
     {
-        if (!(atomicState->m_flags & state_type::InExitSet))
+        if (!m_stateTable.isAtomic(idx)
+            || !(m_stateTable.state(idx)->m_flags & state_type::InExitSet))
+        {
             continue;
+        }
 
-        state_type* state = &*atomicState;
+        state_type* state = m_stateTable.state(idx);
         state_type* parent = state->parent();
         while (parent && (parent->m_flags & state_type::InExitSet))
         {
@@ -398,21 +843,23 @@ void EventDispatcherBase<TDerived>::leaveStatesInExitSet(event_type event)
         }
     }
 
-    for (auto iter = derived().post_order_begin();
-         iter != derived().post_order_end(); ++iter)
+    m_stateBuffer.clear();
+    collectActiveStatesInPostOrder(m_stateBuffer);
+    for (index_type idx : m_stateBuffer)
     {
-        if (iter->m_flags & state_type::InExitSet)
+        state_type* state = m_stateTable.state(idx);
+        if (state->m_flags & state_type::InExitSet)
         {
-            derived().invokeStateExitCallback(&*iter);
+            derived().invokeStateExitCallback(state);
 
-            iter->m_flags &= ~state_type::StartInvoke;
+            state->m_flags &= ~state_type::StartInvoke;
 
-            if (iter->m_flags & state_type::Invoked)
+            if (state->m_flags & state_type::Invoked)
             {
-                iter->m_flags &= ~state_type::Invoked;
+                state->m_flags &= ~state_type::Invoked;
                 try
                 {
-                    iter->exitInvoke();
+                    state->exitInvoke();
                 }
                 catch (...)
                 {
@@ -420,11 +867,20 @@ void EventDispatcherBase<TDerived>::leaveStatesInExitSet(event_type event)
                 }
             }
 
-            iter->m_flags &= ~(state_type::Active | state_type::InExitSet);
+            state->m_flags &= ~(state_type::Active | state_type::InExitSet);
+            removeActiveLeaf(idx);
+            m_changedStates.push_back(state);
+
+            if (m_stateTable.hasTimeoutTransitions(idx))
+            {
+                auto timeouts = m_stateTable.timeoutTransitions(idx);
+                for (auto iter = timeouts.first; iter != timeouts.second; ++iter)
+                    derived().cancelTimeout(*iter);
+            }
 
             try
             {
-                iter->onExit(event);
+                state->onExit(event);
             }
             catch (...)
             {
@@ -435,9 +891,10 @@ void EventDispatcherBase<TDerived>::leaveStatesInExitSet(event_type event)
 }
 
 template <typename TDerived>
-bool EventDispatcherBase<TDerived>::microstep(event_type event)
+bool EventDispatcherBase<TDerived>::microstep(const event_type& event)
 {
     bool changedConfiguration = false;
+    bool needsEntryExpansion = false;
 
     // 1. Mark the states in the exit set for exit and the target state of the
     //    transition for entry.
@@ -450,31 +907,21 @@ bool EventDispatcherBase<TDerived>::microstep(event_type event)
 
         changedConfiguration = true;
 
-        state_type* domain = transitionDomain(transition);
+        updateTransitionCache(transition);
+        state_type* domain = transition->m_domain;
 
         if (prev)
         {
-            // Make sure that no state of the transition domain has been
-            // marked for exit. Otherwise, two transitions have an
-            // overlapping exit set, which means that the transitions
-            // conflict.
-            bool conflict = false;
-            for (auto iter = ++domain->pre_order_begin();
-                 iter != domain->pre_order_end(); ++iter)
-            {
-                if ((iter->m_flags & state_type::Active)
-                    && (iter->m_flags & state_type::InExitSet))
-                {
-                    conflict = true;
-                    break;
-                }
-            }
-
+            // Make sure that the exit set of this transition does not
+            // overlap with the exit set of a preceding transition.
+            // Otherwise, the transitions conflict.
             // In case of a conflict, we simply ignore this transition but
             // keep the old ones.
-            if (conflict)
+            if (transition_type* conflicting
+                    = findConflictingTransition(transition))
             {
-                findTransitionConflict(transition);
+                derived().invokeTransitionConflictAction(conflicting,
+                                                         transition);
                 prev->m_nextInEnabledSet = transition->m_nextInEnabledSet;
                 transition->m_nextInEnabledSet = nullptr;
                 transition = prev;
@@ -484,26 +931,42 @@ bool EventDispatcherBase<TDerived>::microstep(event_type event)
 
         // As there is no conflict, we can set the exit mark for the states in
         // the transition domain.
-        for (auto iter = ++domain->pre_order_begin();
-             iter != domain->pre_order_end(); ++iter)
+        markActiveProperDescendants(domain, state_type::InExitSet);
+
+        // Finally, mark the states to enter. If the entry set is static, it
+        // has been computed in advance. Otherwise, the ancestors of the
+        // target are marked for entry and the children are marked later on.
+        // Note that we cannot mark the children right now, because another
+        // transition can target one of this target's descendants. In both
+        // cases, the ancestors up to the root are marked such that
+        // markDescendantsForEntry() can reach the targets.
+        state_type* ancestor = transition->target();
+        if (transition->m_hasStaticEntrySet)
+        {
+            for (index_type pos = transition->m_firstEntryState;
+                 pos != transition->m_lastEntryState; ++pos)
+            {
+                setTransientFlags(m_stateTable.state(m_entryStates[pos]),
+                                  state_type::InEnterSet);
+            }
+            ancestor = domain;
+        }
+        else
         {
-            if (iter->m_flags & state_type::Active)
-                iter->m_flags |= state_type::InExitSet;
+            needsEntryExpansion = true;
         }
 
-        // Finally, mark the ancestors of the target for entry, too. Note that
-        // we cannot mark the children right now, because another transition
-        // can target one of this target's descendants.
-        state_type* ancestor = transition->target();
         while (ancestor && !(ancestor->m_flags & state_type::InEnterSet))
         {
-            ancestor->m_flags |= state_type::InEnterSet;
+            setTransientFlags(ancestor, state_type::InEnterSet);
             ancestor = ancestor->parent();
         }
     }
 
-    // 2. Propagate the entry mark to the children.
-    markDescendantsForEntry();
+    // 2. Propagate the entry mark to the children. This is only necessary if
+    //    an entry set depends on a history state.
+    if (needsEntryExpansion)
+        markDescendantsForEntry();
 
     // 3. Leave the states in the exit set.
     leaveStatesInExitSet(event);
@@ -523,42 +986,121 @@ bool EventDispatcherBase<TDerived>::microstep(event_type event)
     return changedConfiguration;
 }
 
+template <typename TDerived>
+bool EventDispatcherBase<TDerived>::dispatchEvent(const event_type& event)
+{
+    derived().invokeEventDispatchCallback(event);
+    derived().invokePreTransitionSelectionCallback();
+
+    updateStateTable();
+    clearTransientStateFlags();
+    selectTransitions(false, event);
+    if (!m_enabledTransitions)
+    {
+        derived().invokeEventDiscardedCallback(event);
+        return false;
+    }
+
+    bool changedConfiguration = microstep(event);
+    clearEnabledTransitionsSet();
+    return changedConfiguration;
+}
+
+template <typename TDerived>
+bool EventDispatcherBase<TDerived>::dispatchTimeout(transition_type* transition,
+                                                    std::uint32_t generation)
+{
+    // The timer is outdated, if the source state has been left since it
+    // has been armed. A timeout fires only once per entry.
+    if (transition->m_timeoutGeneration != generation
+        || !(transition->source()->m_flags & state_type::Active))
+    {
+        return false;
+    }
+    ++transition->m_timeoutGeneration;
+
+    derived().invokePreTransitionSelectionCallback();
+
+    updateStateTable();
+    clearTransientStateFlags();
+    const event_type noEvent{};
+    if (transition->guard() && !transition->guard()(noEvent))
+        return false;
+
+    m_enabledTransitions = transition;
+    bool changedConfiguration = microstep(noEvent);
+    clearEnabledTransitionsSet();
+    return changedConfiguration;
+}
+
 template <typename TDerived>
 void EventDispatcherBase<TDerived>::runToCompletion(bool changedConfiguration)
 {
-    // We are in microstepping mode: follow all eventless transitions.
+    const event_type noEvent{};
     while (1)
     {
-        clearTransientStateFlags();
-        selectTransitions(true, event_type());
-        if (!m_enabledTransitions)
+        // We are in microstepping mode: follow all eventless transitions.
+        while (1)
+        {
+            updateStateTable();
+            clearTransientStateFlags();
+            // Skip the selection, if no state has an eventless transition.
+            if (!m_stateTable.subtreeHasEventlessTransitions(0))
+                break;
+            selectTransitions(true, noEvent);
+            if (!m_enabledTransitions)
+                break;
+            changedConfiguration |= microstep(noEvent);
+            clearEnabledTransitionsSet();
+        }
+
+        // Then dispatch the next internal event. The queue is reset once
+        // it has been drained, so its memory is reused.
+        if (m_nextInternalEvent == m_internalEvents.size())
             break;
-        changedConfiguration |= microstep(event_type());
-        clearEnabledTransitionsSet();
+        event_type event = std::move(m_internalEvents[m_nextInternalEvent]);
+        if (++m_nextInternalEvent == m_internalEvents.size())
+        {
+            m_internalEvents.clear();
+            m_nextInternalEvent = 0;
+        }
+        changedConfiguration |= dispatchEvent(event);
     }
 
+    // Only the states, which have been entered or left, can have a
+    // stale visible active flag or a pending invoke action. Sort them
+    // into document order, which is the order of the invoke actions.
+    std::sort(m_changedStates.begin(), m_changedStates.end(),
+              [](const state_type* a, const state_type* b) {
+                  return a->m_index < b->m_index;
+              });
+    m_changedStates.erase(std::unique(m_changedStates.begin(),
+                                      m_changedStates.end()),
+                          m_changedStates.end());
+
     // Synchronize the visible state active flag with the internal
     // state active flag.
     derived().acquireStateActiveFlags();
-    for (auto iter = derived().begin(); iter != derived().end(); ++iter)
+    for (state_type* state : m_changedStates)
     {
-        if (iter->m_flags & state_type::Active)
-            iter->m_flags |= state_type::VisibleActive;
+        if (state->m_flags & state_type::Active)
+            state->m_flags |= state_type::VisibleActive;
         else
-            iter->m_flags &= ~state_type::VisibleActive;
+            state->m_flags &= ~state_type::VisibleActive;
     }
     derived().releaseStateActiveFlags();
 
-    // Call the invoke() methods of all currently active states.
-    for (auto iter = derived().begin(); iter != derived().end(); ++iter)
+    // Call the invoke() methods of the entered states.
+    for (state_type* state : m_changedStates)
     {
-        if (iter->m_flags & state_type::StartInvoke)
+        if (state->m_flags & state_type::StartInvoke)
         {
-            iter->enterInvoke();
-            iter->m_flags &= ~state_type::StartInvoke;
-            iter->m_flags |= state_type::Invoked;
+            state->enterInvoke();
+            state->m_flags &= ~state_type::StartInvoke;
+            state->m_flags |= state_type::Invoked;
         }
     }
+    m_changedStates.clear();
 
     // If we followed at least one transition, which was not target-less,
     // invoke the configuration change callback.
@@ -570,38 +1112,38 @@ void EventDispatcherBase<TDerived>::runToCompletion(bool changedConfiguration)
 }
 
 template <typename TDerived>
-void EventDispatcherBase<TDerived>::findTransitionConflict(
-        transition_type* ignoredTransition)
+auto EventDispatcherBase<TDerived>::findConflictingTransition(
+        const transition_type* transition) const noexcept -> transition_type*
 {
-    if (!derived().hasTransitionConflictAction())
-        return;
-
-    state_type* ignoredDomain = transitionDomain(ignoredTransition);
-    for (auto iter = ++ignoredDomain->pre_order_begin();
-         iter != ignoredDomain->pre_order_end(); ++iter)
+    for (transition_type* iter = m_enabledTransitions; iter != transition;
+         iter = iter->m_nextInEnabledSet)
     {
-        if (iter->m_flags & state_type::Active)
-            iter->m_flags |= state_type::PartOfConflict;
+        if (iter->target() && exitSetsOverlap(iter, transition))
+            return iter;
     }
+    return nullptr;
+}
 
-    for (transition_type* transition = m_enabledTransitions;
-         transition != nullptr;
-         transition = transition->m_nextInEnabledSet)
+template <typename TDerived>
+void EventDispatcherBase<TDerived>::markActiveProperDescendants(
+        const state_type* domain, int flags)
+{
+    // Every active state in the sub-tree is an ancestor of an active leaf
+    // in the sub-tree. So it suffices to walk up from these leaves.
+    index_type first = domain->m_index;
+    index_type end = m_stateTable.subtreeEnd(first);
+    for (auto iter = std::upper_bound(m_activeLeaves.begin(),
+                                      m_activeLeaves.end(), first);
+         iter != m_activeLeaves.end() && *iter < end; ++iter)
     {
-        if (!transition->target())
-            continue;
-
-        state_type* domain = transitionDomain(transition);
-        for (auto iter = ++domain->pre_order_begin();
-             iter != domain->pre_order_end(); ++iter)
+        for (index_type idx = *iter; idx != first;
+             idx = m_stateTable.parent(idx))
         {
-            if (   (iter->m_flags & state_type::Active)
-                && (iter->m_flags & state_type::PartOfConflict))
-            {
-                derived().invokeTransitionConflictAction(
-                            transition, ignoredTransition);
-                return;
-            }
+            state_type* state = m_stateTable.state(idx);
+            // The ancestors of a marked state have been marked, too.
+            if ((state->m_flags & flags) == flags)
+                break;
+            setTransientFlags(state, flags);
         }
     }
 }
@@ -611,8 +1153,9 @@ void EventDispatcherBase<TDerived>::enterInitialStates()
 {
     // TODO: Would be nice, if the state machine had an initial
     // transition similar to initial transitions of states.
+    updateStateTable();
     clearTransientStateFlags();
-    derived().m_flags |= state_type::InEnterSet;
+    setTransientFlags(&derived(), state_type::InEnterSet);
     markDescendantsForEntry();
     enterStatesInEnterSet(event_type());
 }
@@ -620,17 +1163,23 @@ void EventDispatcherBase<TDerived>::enterInitialStates()
 template <typename TDerived>
 void EventDispatcherBase<TDerived>::leaveConfiguration()
 {
-    for (auto iter = derived().begin(); iter != derived().end(); ++iter)
-    {
-        if (iter->m_flags & state_type::Active)
-            iter->m_flags |= state_type::InExitSet;
-    }
+    updateStateTable();
+    m_stateBuffer.clear();
+    collectActiveStatesInPostOrder(m_stateBuffer);
+    for (index_type idx : m_stateBuffer)
+        setTransientFlags(m_stateTable.state(idx), state_type::InExitSet);
     leaveStatesInExitSet(event_type());
 
+    // Every visibly active state has been left by now.
     derived().acquireStateActiveFlags();
-    for (auto iter = derived().begin(); iter != derived().end(); ++iter)
-        iter->m_flags &= ~state_type::VisibleActive;
+    for (state_type* state : m_changedStates)
+        state->m_flags &= ~state_type::VisibleActive;
     derived().releaseStateActiveFlags();
+    m_changedStates.clear();
+
+    // Internal events do not survive a stop.
+    m_internalEvents.clear();
+    m_nextInternalEvent = 0;
 
     ++m_numConfigurationChanges;
     derived().invokeConfigurationChangeCallback();
@@ -657,14 +1206,45 @@ public:
     {
     }
 
-    void addEvent(event_type event)
+    bool addEvent(event_type event)
+    {
+        auto lock = derived().getLock();
+
+        bool accepted = this->pushEvent(std::move(event));
+        doDispatchEvents();
+        return accepted;
+    }
+
+    //! \brief Adds a batch of events.
+    //!
+    //! Adds the events in the range <tt>[first, last)</tt> with a single
+    //! lock acquisition and dispatches them in one pass. If appending an
+    //! event throws, the events, which have been appended before, stay in
+    //! the event list.
+    template <typename TInputIterator>
+    void addEvents(TInputIterator first, TInputIterator last)
     {
         auto lock = derived().getLock();
 
-        derived().m_eventList.push_back(std::move(event));
+        this->pushEvents(first, last);
         doDispatchEvents();
     }
 
+    //! Adds all events of the \p range as a batch.
+    template <typename TRange>
+    void addEvents(const TRange& range)
+    {
+        using std::begin;
+        using std::end;
+        addEvents(begin(range), end(range));
+    }
+
+    //! Adds the given \p events as a batch.
+    void addEvents(std::initializer_list<event_type> events)
+    {
+        addEvents(events.begin(), events.end());
+    }
+
     bool running() const
     {
         auto lock = derived().getLock();
@@ -677,6 +1257,7 @@ public:
         if (!m_running)
         {
             FSM11_SCOPE_FAILURE {
+                m_running = false;
                 this->clearEnabledTransitionsSet();
                 this->leaveConfiguration();
             };
@@ -684,8 +1265,15 @@ public:
             derived().invokePreTransitionSelectionCallback();
             this->resetHistoryStates();
             this->enterInitialStates();
-            this->runToCompletion(true);
+            // The state machine is marked as running before the
+            // configuration change callback is invoked. The events, which
+            // are added in the meantime, are dispatched afterwards.
             m_running = true;
+            {
+                m_dispatching = true;
+                FSM11_SCOPE_EXIT { m_dispatching = false; };
+                this->runToCompletion(true);
+            }
             doDispatchEvents();
         }
     }
@@ -709,27 +1297,75 @@ public:
                       "A synchronous statemachine has no event-loop.");
     }
 
+    template <typename T = void>
+    void exitEventLoop()
+    {
+        static_assert(!std::is_same<T, T>::value,
+                      "A synchronous statemachine has no event-loop.");
+    }
+
 protected:
     void halt()
     {
         stop();
     }
 
-private:
-    bool m_dispatching;
-    bool m_running;
-
-    TDerived& derived()
+    //! The timers of a synchronous state machine are driven by the user.
+    void wakeUpForTimers() noexcept
     {
-        return *static_cast<TDerived*>(this);
     }
 
-    const TDerived& derived() const
+    //! \brief Dispatches expired timers.
+    //!
+    //! The events of the \p timers are added to the event list. The
+    //! timeouts are dispatched after the events, which have expired before
+    //! them.
+    template <typename TTimers>
+    void dispatchTimers(TTimers& timers)
     {
-        return *static_cast<const TDerived*>(this);
-    }
+        auto lock = derived().getLock();
 
-    void doDispatchEvents()
+        for (auto& timer : timers)
+        {
+            if (!timer.transition)
+            {
+                this->pushEvent(std::move(timer.event));
+                continue;
+            }
+
+            doDispatchEvents();
+            if (!m_running || m_dispatching)
+                continue;
+
+            m_dispatching = true;
+            FSM11_SCOPE_EXIT { m_dispatching = false; };
+            FSM11_SCOPE_FAILURE {
+                this->clearEnabledTransitionsSet();
+                this->leaveConfiguration();
+                m_running = false;
+            };
+            this->runToCompletion(this->dispatchTimeout(timer.transition,
+                                                        timer.generation));
+        }
+
+        doDispatchEvents();
+    }
+
+private:
+    bool m_dispatching;
+    bool m_running;
+
+    TDerived& derived()
+    {
+        return *static_cast<TDerived*>(this);
+    }
+
+    const TDerived& derived() const
+    {
+        return *static_cast<const TDerived*>(this);
+    }
+
+    void doDispatchEvents()
     {
         if (!m_running || m_dispatching)
             return;
@@ -744,42 +1380,53 @@ private:
 
         while (!derived().m_eventList.empty())
         {
-            auto event = derived().m_eventList.front();
+            auto event = std::move(derived().m_eventList.front());
             derived().m_eventList.pop_front();
 
-            derived().invokeEventDispatchCallback(event);
-            derived().invokePreTransitionSelectionCallback();
-
-            this->clearTransientStateFlags();
-            this->selectTransitions(false, event);
-            bool changedConfiguration = false;
-            if (this->m_enabledTransitions)
-            {
-                changedConfiguration = this->microstep(std::move(event));
-                this->clearEnabledTransitionsSet();
-            }
-            else
-            {
-                derived().invokeEventDiscardedCallback(std::move(event));
-            }
-
-            this->runToCompletion(changedConfiguration);
+            this->runToCompletion(this->dispatchEvent(event));
         }
     }
 };
 
+// ----=====================================================================----
+//     AsynchronousEventDispatcher
+// ----=====================================================================----
+
+//! Checks if events can be pushed to an event list of type \p TList without
+//! holding a lock. Such a list has to define a static member
+//! \p lock_free_push, which is \p true.
+template <typename TList, typename TEnable = void>
+struct is_lock_free_event_list : public std::false_type
+{
+};
+
+template <typename TList>
+struct is_lock_free_event_list<
+        TList, typename std::enable_if<TList::lock_free_push>::type>
+    : public std::true_type
+{
+};
+
 template <typename TDerived>
 class AsynchronousEventDispatcher : public EventDispatcherBase<TDerived>
 {
     using options = typename get_options<TDerived>::type;
 
+    static constexpr bool lock_free_event_list
+            = is_lock_free_event_list<typename options::event_list_type>::value;
+    static constexpr bool blocking_event_list
+            = is_blocking_event_list<typename options::event_list_type>::value;
+
 public:
     using event_type = typename options::event_type;
 
     AsynchronousEventDispatcher()
         : m_startRequest(false),
           m_stopRequest(false),
+          m_exitRequest(false),
           m_eventLoopActive(false),
+          m_eventLoopWaiting(false),
+          m_timerRequest(false),
           m_running(false)
     {
     }
@@ -787,14 +1434,73 @@ public:
     AsynchronousEventDispatcher(const AsynchronousEventDispatcher&) = delete;
     AsynchronousEventDispatcher& operator=(const AsynchronousEventDispatcher&) = delete;
 
-    void addEvent(event_type event)
+    //! \brief Adds an event.
+    //!
+    //! Adds the \p event to the event list and wakes up the event loop.
+    //! Returns \p false, if a bounded event list has rejected the event.
+    //! If the event list blocks when it is full, the caller is blocked until
+    //! the event loop has made room. Only an action, which is executed by
+    //! the event loop, is not blocked. Its event is rejected instead.
+    bool addEvent(event_type event)
     {
+        if (lock_free_event_list)
         {
-            std::lock_guard<std::mutex> lock(m_eventLoopMutex);
-            derived().m_eventList.push_back(std::move(event));
+            bool accepted = this->pushEvent(std::move(event));
+            wakeUpEventLoop();
+            return accepted;
+        }
+
+        bool accepted;
+        {
+            std::unique_lock<std::mutex> lock(m_eventLoopMutex);
+            waitForRoomInEventList(lock);
+            accepted = this->pushEvent(std::move(event));
         }
 
         m_continueEventLoop.notify_one();
+        return accepted;
+    }
+
+    //! \brief Adds a batch of events.
+    //!
+    //! Adds the events in the range <tt>[first, last)</tt> with a single
+    //! lock acquisition and wakes up the event loop once. If appending an
+    //! event throws, the events, which have been appended before, stay in
+    //! the event list. A bounded event list, which does not block the
+    //! caller, may reject some of the events. Use addEvent() to find out
+    //! whether an event has been accepted.
+    template <typename TInputIterator>
+    void addEvents(TInputIterator first, TInputIterator last)
+    {
+        if (lock_free_event_list)
+        {
+            FSM11_SCOPE_EXIT { wakeUpEventLoop(); };
+            this->pushEvents(first, last);
+            return;
+        }
+
+        FSM11_SCOPE_EXIT { m_continueEventLoop.notify_one(); };
+        std::unique_lock<std::mutex> lock(m_eventLoopMutex);
+        for (; first != last; ++first)
+        {
+            waitForRoomInEventList(lock);
+            this->pushEvent(*first);
+        }
+    }
+
+    //! Adds all events of the \p range as a batch.
+    template <typename TRange>
+    void addEvents(const TRange& range)
+    {
+        using std::begin;
+        using std::end;
+        addEvents(begin(range), end(range));
+    }
+
+    //! Adds the given \p events as a batch.
+    void addEvents(std::initializer_list<event_type> events)
+    {
+        addEvents(events.begin(), events.end());
     }
 
     bool running() const
@@ -811,45 +1517,108 @@ public:
         m_continueEventLoop.notify_one();
     }
 
+    //! Requests to stop the state machine. A pending start request is
+    //! dropped. A start() after this call restarts the state machine once
+    //! it has been stopped.
     void stop()
     {
         m_eventLoopMutex.lock();
+        m_startRequest = false;
         m_stopRequest = true;
         m_eventLoopMutex.unlock();
         m_continueEventLoop.notify_one();
     }
 
+    //! \brief Runs the event loop.
+    //!
+    //! Runs the event loop in the calling thread. By default, the function
+    //! returns after the state machine has been stopped. If the event loop
+    //! is persistent (see PersistentEventLoop), it waits for the next
+    //! start() instead and returns only after exitEventLoop() has been
+    //! called or the state machine is destroyed.
     void eventLoop()
     {
         {
             std::lock_guard<std::mutex> eventLoopLock(m_eventLoopMutex);
             // TODO: if (m_eventLoopRunning) throw;
             m_eventLoopActive = true;
+            m_eventLoopThread = std::this_thread::get_id();
         }
 
         doEventLoop();
     }
 
+    //! \brief Exits the event loop.
+    //!
+    //! Stops the state machine, if it is running, and makes eventLoop()
+    //! return. If the event loop has not been entered yet, the next call
+    //! to eventLoop() returns immediately.
+    void exitEventLoop()
+    {
+        m_eventLoopMutex.lock();
+        m_exitRequest = true;
+        m_eventLoopMutex.unlock();
+        m_continueEventLoop.notify_all();
+    }
+
 protected:
     void halt()
     {
-        stop();
+        exitEventLoop();
         std::unique_lock<std::mutex> eventLoopLock(m_eventLoopMutex);
         m_continueEventLoop.wait(eventLoopLock,
                                  [this]{ return !m_eventLoopActive; });
     }
 
+    template <typename TTimers>
+    void dispatchTimers(TTimers&)
+    {
+        static_assert(!std::is_same<TTimers, TTimers>::value,
+                      "The event loop processes the timers of an asynchronous statemachine.");
+    }
+
+    //! Wakes up the event loop because a timer has been armed, which
+    //! expires before the event loop would wake up otherwise.
+    void wakeUpForTimers()
+    {
+        m_eventLoopMutex.lock();
+        m_timerRequest = true;
+        m_eventLoopMutex.unlock();
+        m_continueEventLoop.notify_all();
+    }
+
 private:
     //! A mutex to prevent concurrent modifications of the request flags.
     mutable std::mutex m_eventLoopMutex;
     //! This CV signals that a new control event is available.
     std::condition_variable m_continueEventLoop;
     //! Set if starting the state machine has been requested.
-    bool m_startRequest;
-    //! Set if stopping the state machine has been requested.
-    bool m_stopRequest;
+    std::atomic<bool> m_startRequest;
+    //! Set if stopping the state machine has been requested. Atomic because
+    //! the event loop peeks at it without locking when the event list is
+    //! lock-free.
+    std::atomic<bool> m_stopRequest;
+    //! Set if leaving the event loop has been requested.
+    std::atomic<bool> m_exitRequest;
+    //! This CV signals that an event has been removed from a blocking
+    //! event list.
+    std::condition_variable m_eventListNotFull;
     //! Set if the event loop is running.
     bool m_eventLoopActive;
+    //! The thread, which runs the event loop. Guarded by m_eventLoopMutex.
+    std::thread::id m_eventLoopThread;
+    //! Set while the event loop is (about to be) blocked on the condition
+    //! variable. Producers of a lock-free event list only need to lock the
+    //! mutex and notify the event loop if this flag is set.
+    std::atomic<bool> m_eventLoopWaiting;
+    //! Set if the event loop has to re-compute the time at which the next
+    //! timer expires.
+    bool m_timerRequest;
+    //! The expired timers. Only accessed by the event loop.
+    std::vector<TimerEntry<TDerived>> m_expiredTimers;
+    //! The events, which are dispatched with a single acquisition of the
+    //! state machine's lock. Only accessed by the event loop.
+    std::vector<event_type> m_eventBatch;
 
     //! Set if the state machine is running. Guarded by the multithreading
     //! lock but not by m_eventLoopMutex.
@@ -865,32 +1634,95 @@ private:
         return *static_cast<const TDerived*>(this);
     }
 
+    //! \brief Wakes up the event loop after a lock-free push.
+    //!
+    //! The fence pairs with the one in doEventLoop(): Either the event loop
+    //! sees the new event before it goes to sleep or this function sees
+    //! that the event loop is waiting. Only in the latter case, the mutex
+    //! is locked (to not lose the notification) and the CV is signalled.
+    void wakeUpEventLoop()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_eventLoopWaiting.load(std::memory_order_relaxed))
+        {
+            m_eventLoopMutex.lock();
+            m_eventLoopMutex.unlock();
+            m_continueEventLoop.notify_one();
+        }
+    }
+
+    //! Blocks the caller while a blocking event list is full. The
+    //! \p lock must hold the m_eventLoopMutex. The event loop itself is
+    //! never blocked, because it would wait for itself. When an action adds
+    //! an event to a full list, the list rejects the event instead.
+    void waitForRoomInEventList(std::unique_lock<std::mutex>& lock)
+    {
+        waitForRoomInEventList(
+                lock, std::integral_constant<bool, blocking_event_list>());
+    }
+
+    void waitForRoomInEventList(std::unique_lock<std::mutex>&, std::false_type)
+    {
+    }
+
+    void waitForRoomInEventList(std::unique_lock<std::mutex>& lock, std::true_type)
+    {
+        if (derived().m_eventList.full()
+            && m_eventLoopThread != std::this_thread::get_id())
+        {
+            // The event loop might not have been notified about the
+            // events of the current batch, yet.
+            m_continueEventLoop.notify_one();
+            m_eventListNotFull.wait(
+                        lock, [this]{ return !derived().m_eventList.full(); });
+        }
+    }
+
     void doEventLoop()
     {
         FSM11_SCOPE_EXIT {
             m_eventLoopMutex.lock();
             m_eventLoopActive = false;
+            m_eventLoopThread = std::thread::id();
             m_eventLoopMutex.unlock();
             m_continueEventLoop.notify_all();
         };
 
         do
         {
-            // Wait until a start or stop request has been sent.
+            // Wait until a start, stop or exit request has been sent.
             std::unique_lock<std::mutex> eventLoopLock(m_eventLoopMutex);
-            m_continueEventLoop.wait(eventLoopLock,
-                                     [this]{ return m_startRequest || m_stopRequest; });
-            m_startRequest = false;
-            if (m_stopRequest)
+            m_continueEventLoop.wait(
+                        eventLoopLock,
+                        [this]{ return m_startRequest || m_stopRequest || m_exitRequest; });
+            if (m_exitRequest)
             {
+                m_startRequest = false;
                 m_stopRequest = false;
+                m_exitRequest = false;
                 return;
             }
+            if (m_stopRequest)
+            {
+                // The state machine is stopped already. As stop() drops
+                // a pending start, a start request has been issued after
+                // the stop and is served. Otherwise, a persistent event
+                // loop ignores the stop request.
+                m_stopRequest = false;
+                if (!m_startRequest)
+                {
+                    if (!options::persistent_event_loop)
+                        return;
+                    continue;
+                }
+            }
+            m_startRequest = false;
             eventLoopLock.unlock();
 
             {
                 auto lock = derived().getLock();
                 FSM11_SCOPE_FAILURE {
+                    m_running = false;
                     this->clearEnabledTransitionsSet();
                     this->leaveConfiguration();
                 };
@@ -898,37 +1730,108 @@ private:
                 derived().invokePreTransitionSelectionCallback();
                 this->resetHistoryStates();
                 this->enterInitialStates();
-                this->runToCompletion(true);
+                // The state machine has to be marked as running before the
+                // configuration change callback is invoked. Otherwise, a
+                // thread waiting for the callback may see a stopped machine.
                 m_running = true;
+                this->runToCompletion(true);
             }
 
             while (true)
             {
-                typename options::event_type event;
-
-                // Wait until either an event is added to the list or
-                // an FSM stop has been requested.
-                eventLoopLock.lock();
-                m_continueEventLoop.wait(
-                            eventLoopLock,
-                            [this]{ return !derived().m_eventList.empty() || m_stopRequest; });
-                m_startRequest = false;
-                if (m_stopRequest)
+                // Dispatch the events of the expired timers and find out
+                // when the next timer expires.
+                auto timerDeadline = derived().collectExpiredTimers(m_expiredTimers);
+                if (!m_expiredTimers.empty())
                 {
-                    m_stopRequest = false;
+                    FSM11_SCOPE_EXIT { m_expiredTimers.clear(); };
                     auto lock = derived().getLock();
-                    m_running = false;
-                    FSM11_SCOPE_FAILURE { this->leaveConfiguration(); };
-                    derived().invokePreTransitionSelectionCallback();
-                    this->leaveConfiguration();
-                    break;
+                    FSM11_SCOPE_FAILURE {
+                        m_running = false;
+                        this->clearEnabledTransitionsSet();
+                        this->leaveConfiguration();
+                    };
+
+                    for (const auto& timer : m_expiredTimers)
+                    {
+                        this->runToCompletion(
+                                timer.transition
+                                ? this->dispatchTimeout(timer.transition,
+                                                        timer.generation)
+                                : this->dispatchEvent(timer.event));
+                    }
                 }
 
-                // Get the next event from the event list.
-                event = derived().m_eventList.front();
-                derived().m_eventList.pop_front(); // TODO: What if this throws?
-                eventLoopLock.unlock();
+                // A lock-free event list is consumed without locking as
+                // long as it has events and no stop has been requested.
+                if (!lock_free_event_list || m_stopRequest || m_exitRequest
+                    || derived().m_eventList.empty())
+                {
+                    // Wait until either an event is added to the list, an
+                    // FSM stop has been requested or a timer expires.
+                    eventLoopLock.lock();
+                    m_eventLoopWaiting = true;
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    auto wakeUp = [this] {
+                        return !derived().m_eventList.empty() || m_stopRequest
+                               || m_exitRequest || m_timerRequest;
+                    };
+                    if (timerDeadline == decltype(timerDeadline)::max())
+                        m_continueEventLoop.wait(eventLoopLock, wakeUp);
+                    else
+                        m_continueEventLoop.wait_until(eventLoopLock,
+                                                       timerDeadline, wakeUp);
+                    m_eventLoopWaiting = false;
+                    m_timerRequest = false;
+                    if (m_stopRequest || m_exitRequest)
+                    {
+                        // A persistent event loop handles an exit request
+                        // when it waits for the next start. A start request
+                        // has been issued after the stop and is kept, such
+                        // that the state machine is restarted.
+                        m_stopRequest = false;
+                        if (!options::persistent_event_loop)
+                            m_exitRequest = false;
+                        auto lock = derived().getLock();
+                        m_running = false;
+                        FSM11_SCOPE_FAILURE { this->leaveConfiguration(); };
+                        derived().invokePreTransitionSelectionCallback();
+                        this->leaveConfiguration();
+                        break;
+                    }
+                    // The state machine is running already.
+                    m_startRequest = false;
 
+                    // Process the timers, if the event loop has been woken
+                    // up by them.
+                    if (derived().m_eventList.empty())
+                    {
+                        eventLoopLock.unlock();
+                        continue;
+                    }
+                }
+
+                // Move a batch of events out of the event list. Requests
+                // are checked again after the whole batch has been
+                // dispatched.
+                std::size_t batchSize = 0;
+                do
+                {
+                    m_eventBatch.push_back(std::move(derived().m_eventList.front()));
+                    derived().m_eventList.pop_front(); // TODO: What if this throws?
+                } while (++batchSize < options::event_loop_batch_size
+                         && !derived().m_eventList.empty());
+                if (eventLoopLock.owns_lock())
+                    eventLoopLock.unlock();
+                if (blocking_event_list)
+                {
+                    if (batchSize == 1)
+                        m_eventListNotFull.notify_one();
+                    else
+                        m_eventListNotFull.notify_all();
+                }
+
+                FSM11_SCOPE_EXIT { m_eventBatch.clear(); };
                 auto lock = derived().getLock();
                 FSM11_SCOPE_FAILURE {
                     m_running = false;
@@ -936,44 +1839,333 @@ private:
                     this->leaveConfiguration();
                 };
 
-                derived().invokeEventDispatchCallback(event);
-                derived().invokePreTransitionSelectionCallback();
+                for (const auto& event : m_eventBatch)
+                    this->runToCompletion(this->dispatchEvent(event));
+            }
+        } while (options::persistent_event_loop);
+    }
+};
 
-                this->clearTransientStateFlags();
-                this->selectTransitions(false, event);
-                bool changedConfiguration = false;
-                if (this->m_enabledTransitions)
-                {
-                    changedConfiguration
-                            = this->microstep(std::move(event));
+// ----=====================================================================----
+//     ExecutorEventDispatcher
+// ----=====================================================================----
+
+template <typename TDerived>
+class ExecutorEventDispatcher : public EventDispatcherBase<TDerived>,
+                                private ExecutorTask
+{
+    using options = typename get_options<TDerived>::type;
+
+    static_assert(!is_blocking_event_list<typename options::event_list_type>::value,
+                  "A full event list must not block the executor.");
+    static_assert(!options::timer_service_enable,
+                  "The timer service needs an event loop.");
+
+public:
+    using event_type = typename options::event_type;
+
+    explicit
+    ExecutorEventDispatcher(Executor& executor)
+        : m_executor(executor),
+          m_runRequest(false),
+          m_halted(false),
+          m_scheduled(false),
+          m_running(false)
+    {
+    }
+
+    ExecutorEventDispatcher(const ExecutorEventDispatcher&) = delete;
+    ExecutorEventDispatcher& operator=(const ExecutorEventDispatcher&) = delete;
+
+    //! \brief Adds an event.
+    //!
+    //! Adds the \p event to the event list and schedules the state machine
+    //! in the executor. Returns \p false, if a bounded event list has
+    //! rejected the event.
+    bool addEvent(event_type event)
+    {
+        bool accepted;
+        bool schedule;
+        {
+            std::lock_guard<std::mutex> lock(m_taskMutex);
+            accepted = this->pushEvent(std::move(event));
+            schedule = markScheduled();
+        }
+
+        if (schedule)
+            m_executor.schedule(this);
+        return accepted;
+    }
+
+    //! \brief Adds a batch of events.
+    //!
+    //! Adds the events in the range <tt>[first, last)</tt> with a single
+    //! lock acquisition and schedules the state machine once. If appending
+    //! an event throws, the events, which have been appended before, stay
+    //! in the event list.
+    template <typename TInputIterator>
+    void addEvents(TInputIterator first, TInputIterator last)
+    {
+        std::unique_lock<std::mutex> lock(m_taskMutex);
+        FSM11_SCOPE_EXIT {
+            if (!derived().m_eventList.empty() && markScheduled())
+            {
+                lock.unlock();
+                m_executor.schedule(this);
+            }
+        };
+        this->pushEvents(first, last);
+    }
+
+    //! Adds all events of the \p range as a batch.
+    template <typename TRange>
+    void addEvents(const TRange& range)
+    {
+        using std::begin;
+        using std::end;
+        addEvents(begin(range), end(range));
+    }
+
+    //! Adds the given \p events as a batch.
+    void addEvents(std::initializer_list<event_type> events)
+    {
+        addEvents(events.begin(), events.end());
+    }
+
+    bool running() const
+    {
+        auto lock = derived().getLock();
+        return m_running;
+    }
+
+    void start()
+    {
+        requestRun(true);
+    }
+
+    void stop()
+    {
+        requestRun(false);
+    }
+
+    template <typename T = void>
+    void eventLoop()
+    {
+        static_assert(!std::is_same<T, T>::value,
+                      "A statemachine, which is run by an executor, has no event-loop.");
+    }
+
+    template <typename T = void>
+    void exitEventLoop()
+    {
+        static_assert(!std::is_same<T, T>::value,
+                      "A statemachine, which is run by an executor, has no event-loop.");
+    }
+
+protected:
+    //! \brief Halts the state machine.
+    //!
+    //! Removes the state machine from the executor's queue, if it is
+    //! scheduled but not executed yet. Otherwise, waits until the executor
+    //! has finished the current time slice. Then the state machine is
+    //! stopped in the calling thread.
+    void halt()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_taskMutex);
+            m_halted = true;
+            if (m_scheduled && m_executor.cancel(this))
+                m_scheduled = false;
+            m_idle.wait(lock, [this] { return !m_scheduled; });
+        }
+
+        auto lock = derived().getLock();
+        if (m_running)
+        {
+            m_running = false;
+            FSM11_SCOPE_FAILURE { this->leaveConfiguration(); };
+            derived().invokePreTransitionSelectionCallback();
+            this->leaveConfiguration();
+        }
+    }
+
+private:
+    //! The executor, which runs this state machine.
+    Executor& m_executor;
+    //! A mutex, which guards the event list and the scheduling flags.
+    mutable std::mutex m_taskMutex;
+    //! This CV signals that the state machine is no longer scheduled.
+    std::condition_variable m_idle;
+    //! Set if the state machine shall run. The executor starts or stops
+    //! the state machine, if this flag differs from m_running.
+    bool m_runRequest;
+    //! Set when the state machine or its executor is destroyed.
+    bool m_halted;
+    //! Set from the time the state machine has been scheduled until the
+    //! executor has finished its time slice, or until the time slice has
+    //! been cancelled or discarded.
+    bool m_scheduled;
+    //! The events, which are dispatched with a single acquisition of the
+    //! state machine's lock. Only accessed by the executor.
+    std::vector<event_type> m_eventBatch;
+
+    //! Set if the state machine is running. Guarded by the multithreading
+    //! lock but not by m_taskMutex. Only modified by the executor.
+    bool m_running;
+
+    TDerived& derived()
+    {
+        return *static_cast<TDerived*>(this);
+    }
+
+    const TDerived& derived() const
+    {
+        return *static_cast<const TDerived*>(this);
+    }
+
+    //! Marks the state machine as scheduled. Returns \p true, if the
+    //! caller has to schedule it. The caller has to hold m_taskMutex.
+    bool markScheduled() noexcept
+    {
+        if (m_scheduled || m_halted)
+            return false;
+        m_scheduled = true;
+        return true;
+    }
+
+    void requestRun(bool run)
+    {
+        bool schedule;
+        {
+            std::lock_guard<std::mutex> lock(m_taskMutex);
+            m_runRequest = run;
+            schedule = markScheduled();
+        }
+
+        if (schedule)
+            m_executor.schedule(this);
+    }
+
+    //! Runs a time slice in the executor. Handles a start or stop request
+    //! and dispatches a batch of events.
+    virtual
+    void execute() override
+    {
+        FSM11_SCOPE_FAILURE {
+            std::lock_guard<std::mutex> lock(m_taskMutex);
+            m_runRequest = false;
+            m_scheduled = false;
+            m_idle.notify_all();
+        };
+
+        std::unique_lock<std::mutex> taskLock(m_taskMutex);
+        bool runRequest = m_runRequest && !m_halted;
+        taskLock.unlock();
+
+        if (runRequest != m_running)
+        {
+            auto lock = derived().getLock();
+            if (runRequest)
+            {
+                FSM11_SCOPE_FAILURE {
+                    m_running = false;
                     this->clearEnabledTransitionsSet();
-                }
-                else
-                {
-                    derived().invokeEventDiscardedCallback(std::move(event));
-                }
+                    this->leaveConfiguration();
+                };
+
+                derived().invokePreTransitionSelectionCallback();
+                this->resetHistoryStates();
+                this->enterInitialStates();
+                m_running = true;
+                this->runToCompletion(true);
+            }
+            else
+            {
+                m_running = false;
+                FSM11_SCOPE_FAILURE { this->leaveConfiguration(); };
+                derived().invokePreTransitionSelectionCallback();
+                this->leaveConfiguration();
+            }
+        }
 
-                this->runToCompletion(changedConfiguration);
+        if (m_running)
+        {
+            // Move a batch of events out of the event list.
+            taskLock.lock();
+            std::size_t batchSize = 0;
+            while (batchSize < options::event_loop_batch_size
+                   && !m_halted && !derived().m_eventList.empty())
+            {
+                m_eventBatch.push_back(std::move(derived().m_eventList.front()));
+                derived().m_eventList.pop_front();
+                ++batchSize;
             }
-        } while (false); // TODO: have an option to continue looping even after a stop request
+            taskLock.unlock();
+
+            FSM11_SCOPE_EXIT { m_eventBatch.clear(); };
+            auto lock = derived().getLock();
+            FSM11_SCOPE_FAILURE {
+                m_running = false;
+                this->clearEnabledTransitionsSet();
+                this->leaveConfiguration();
+            };
+
+            for (const auto& event : m_eventBatch)
+                this->runToCompletion(this->dispatchEvent(event));
+        }
+
+        // Re-schedule the state machine at the end of the ready-queue, if
+        // there is more work. Otherwise, this is the last access to the
+        // state machine from the executor as it may be destroyed as soon
+        // as the mutex is released.
+        taskLock.lock();
+        if (!m_halted
+            && (m_runRequest != m_running
+                || (m_running && !derived().m_eventList.empty())))
+        {
+            taskLock.unlock();
+            m_executor.schedule(this);
+            return;
+        }
+        m_scheduled = false;
+        m_idle.notify_all();
+    }
+
+    //! The executor has been destroyed before it has run the time slice.
+    //! The state machine is not scheduled any more.
+    virtual
+    void discard() noexcept override
+    {
+        std::lock_guard<std::mutex> lock(m_taskMutex);
+        m_halted = true;
+        m_scheduled = false;
+        m_idle.notify_all();
     }
 };
 
-template <bool TSynchronous, typename TOptions>
+template <bool TSynchronous, bool TExecutor, typename TOptions>
 struct get_dispatcher_helper
 {
     typedef SynchronousEventDispatcher<StateMachineImpl<TOptions>> type;
 };
 
 template <typename TOptions>
-struct get_dispatcher_helper<false, TOptions>
+struct get_dispatcher_helper<false, false, TOptions>
 {
     typedef AsynchronousEventDispatcher<StateMachineImpl<TOptions>> type;
 };
 
+template <typename TOptions>
+struct get_dispatcher_helper<false, true, TOptions>
+{
+    typedef ExecutorEventDispatcher<StateMachineImpl<TOptions>> type;
+};
+
 template <typename TOptions>
 struct get_dispatcher
-        : public get_dispatcher_helper<TOptions::synchronous_dispatch, TOptions>
+        : public get_dispatcher_helper<TOptions::synchronous_dispatch,
+                                       TOptions::executor_dispatch,
+                                       TOptions>
 {
 };
 
@@ -0,0 +1,884 @@
+/*******************************************************************************
+  fsm11 - A C++ library for finite state machines
+
+  Copyright (c) 2015-2016, Manuel Freiberger
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  - Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+  - Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#ifndef FSM11_DETAIL_EVENTINDEX_HPP
+#define FSM11_DETAIL_EVENTINDEX_HPP
+
+#include "../statemachine_fwd.hpp"
+#include "../variantevent.hpp"
+
+#ifdef FSM11_USE_WEOS
+#include <weos/type_traits.hpp>
+#include <weos/utility.hpp>
+#else
+#include <type_traits>
+#include <utility>
+#endif // FSM11_USE_WEOS
+
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace fsm11
+{
+namespace fsm11_detail
+{
+
+// ----=====================================================================----
+//     Event index traits
+// ----=====================================================================----
+
+//! The ways in which the event index can map an event to transitions.
+enum EventIndexKind
+{
+    //! The events can only be compared. Every transition is a candidate.
+    LinearEventIndex,
+    //! The events are hashed.
+    HashedEventIndex,
+    //! The events are integers or enumerations. A dense jump table is
+    //! used if the events of a state are clustered.
+    IntegralEventIndex,
+    //! The events are VariantEvents. A jump table indexed by the
+    //! alternative is used.
+    VariantEventIndex,
+    //! The events are strings made of dot-separated tokens. The event of
+    //! a transition is a prefix, which is looked up in a trie.
+    PrefixEventIndex
+};
+
+//! Checks if \p TType can be hashed with std::hash and compared with
+//! operator==.
+template <typename TType>
+class is_hashable
+{
+    template <typename T,
+              typename = decltype(std::hash<T>()(std::declval<const T&>())),
+              typename = decltype(std::declval<const T&>()
+                                  == std::declval<const T&>())>
+    static std::true_type test(int);
+
+    template <typename T>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<TType>(0))::value;
+};
+
+template <typename TEvent>
+struct get_event_index_kind
+        : std::integral_constant<
+              EventIndexKind,
+              is_variant_event<TEvent>::value
+              ? VariantEventIndex
+              : std::is_integral<TEvent>::value || std::is_enum<TEvent>::value
+              ? IntegralEventIndex
+              : is_hashable<TEvent>::value ? HashedEventIndex
+                                           : LinearEventIndex>
+{
+};
+
+//! Maps an integral or enumeration \p value to an unsigned key such that
+//! the order of the values is preserved.
+template <typename TEvent>
+inline
+std::uintmax_t integral_event_key(TEvent value, std::false_type /*isEnum*/) noexcept
+{
+    using namespace std;
+
+    return is_signed<TEvent>::value
+           ? uintmax_t(intmax_t(value))
+             - uintmax_t(numeric_limits<intmax_t>::min())
+           : uintmax_t(value);
+}
+
+template <typename TEvent>
+inline
+std::uintmax_t integral_event_key(TEvent value, std::true_type /*isEnum*/) noexcept
+{
+    using underlying_type = typename std::underlying_type<TEvent>::type;
+    return integral_event_key(static_cast<underlying_type>(value),
+                              std::false_type());
+}
+
+// ----=====================================================================----
+//     EventIndexBase
+// ----=====================================================================----
+
+//! \brief The common part of all event indices.
+//!
+//! The index stores the candidate transitions of every state in a single
+//! array. For every state there is a range of eventless transitions and
+//! for every event which triggers at least one transition in this state,
+//! there is a range containing the transitions for this event merged with
+//! the eventless transitions (because an eventless transition matches every
+//! event). The order of the candidates is the order in which the
+//! transitions have been added.
+template <typename TTransition>
+class EventIndexBase
+{
+public:
+    using index_type = std::uint32_t;
+    using iterator = TTransition* const*;
+    using event_type = typename TTransition::event_type;
+
+    //! Returns the eventless transitions of the \p state.
+    std::pair<iterator, iterator> eventless(index_type state) const noexcept
+    {
+        return range(m_eventless[state]);
+    }
+
+    //! Checks if a candidate transition with the event \p transitionEvent
+    //! is triggered by the \p event. This is always the case for an index,
+    //! which maps events exactly.
+    static bool matches(const event_type& /*transitionEvent*/,
+                        const event_type& /*event*/) noexcept
+    {
+        return true;
+    }
+
+protected:
+    struct Range
+    {
+        index_type first;
+        index_type last;
+    };
+
+    //! The candidate transitions of all states.
+    std::vector<TTransition*> m_candidates;
+    //! The eventless transitions of every state.
+    std::vector<Range> m_eventless;
+
+    void clearBase()
+    {
+        m_candidates.clear();
+        m_eventless.clear();
+    }
+
+    std::pair<iterator, iterator> range(Range r) const noexcept
+    {
+        return std::pair<iterator, iterator>(m_candidates.data() + r.first,
+                                             m_candidates.data() + r.last);
+    }
+
+    //! Appends the eventless transitions from the sequence
+    //! <tt>[begin, end)</tt> and returns their positions in this sequence.
+    std::vector<std::size_t> addEventless(iterator begin, iterator end)
+    {
+        std::vector<std::size_t> positions;
+        Range r;
+        r.first = index_type(m_candidates.size());
+        for (iterator iter = begin; iter != end; ++iter)
+        {
+            if ((*iter)->eventless())
+            {
+                positions.push_back(std::size_t(iter - begin));
+                m_candidates.push_back(*iter);
+            }
+        }
+        r.last = index_type(m_candidates.size());
+        m_eventless.push_back(r);
+        return positions;
+    }
+
+    //! Appends the transitions at the given \p positions merged with the
+    //! \p eventless positions and returns the resulting range.
+    Range addCandidates(iterator begin,
+                        const std::vector<std::size_t>& positions,
+                        const std::vector<std::size_t>& eventless)
+    {
+        Range r;
+        r.first = index_type(m_candidates.size());
+        auto iter1 = positions.begin();
+        auto iter2 = eventless.begin();
+        while (iter1 != positions.end() || iter2 != eventless.end())
+        {
+            if (iter2 == eventless.end()
+                || (iter1 != positions.end() && *iter1 < *iter2))
+            {
+                m_candidates.push_back(begin[*iter1++]);
+            }
+            else
+            {
+                m_candidates.push_back(begin[*iter2++]);
+            }
+        }
+        r.last = index_type(m_candidates.size());
+        return r;
+    }
+
+    //! Groups the transitions with an event in <tt>[begin, end)</tt> by a
+    //! key. The keys are returned in the order of their first appearance
+    //! together with the positions of the transitions.
+    template <typename TKey, typename TKeyFunction, typename THash>
+    static void group(iterator begin, iterator end, TKeyFunction keyFunction,
+                      std::vector<TKey>& keys,
+                      std::vector<std::vector<std::size_t>>& positions)
+    {
+        std::unordered_map<TKey, std::size_t, THash> groups;
+        for (iterator iter = begin; iter != end; ++iter)
+        {
+            if ((*iter)->eventless())
+                continue;
+
+            TKey key = keyFunction((*iter)->event());
+            auto result = groups.insert(std::make_pair(key, keys.size()));
+            if (result.second)
+            {
+                keys.push_back(key);
+                positions.emplace_back();
+            }
+            positions[result.first->second].push_back(
+                        std::size_t(iter - begin));
+        }
+    }
+};
+
+// ----=====================================================================----
+//     EventIndex
+// ----=====================================================================----
+
+//! \brief Maps events to candidate transitions.
+//!
+//! This is the fallback for event types, which can neither be hashed nor
+//! converted to an integer. Every transition of a state is a candidate and
+//! the dispatcher has to compare the events.
+template <typename TTransition,
+          EventIndexKind TKind = get_event_index_kind<
+                                     typename TTransition::event_type>::value>
+class EventIndex : public EventIndexBase<TTransition>
+{
+    using base_type = EventIndexBase<TTransition>;
+
+public:
+    using typename base_type::event_type;
+    using typename base_type::index_type;
+    using typename base_type::iterator;
+
+    //! Set if the candidates returned from find() match the event exactly.
+    static constexpr bool exact = false;
+
+    static bool matches(const event_type& transitionEvent,
+                        const event_type& event)
+    {
+        return !(transitionEvent != event);
+    }
+
+    void clear()
+    {
+        this->clearBase();
+        m_all.clear();
+    }
+
+    //! Adds the next state, whose transitions are <tt>[begin, end)</tt>.
+    void addState(iterator begin, iterator end)
+    {
+        this->addEventless(begin, end);
+        typename base_type::Range r;
+        r.first = index_type(this->m_candidates.size());
+        this->m_candidates.insert(this->m_candidates.end(), begin, end);
+        r.last = index_type(this->m_candidates.size());
+        m_all.push_back(r);
+    }
+
+    //! Returns the candidate transitions of the \p state for the \p event.
+    std::pair<iterator, iterator> find(index_type state,
+                                       const event_type&) const noexcept
+    {
+        return this->range(m_all[state]);
+    }
+
+private:
+    std::vector<typename base_type::Range> m_all;
+};
+
+//! \brief An event index based on a hash table.
+template <typename TTransition>
+class EventIndex<TTransition, HashedEventIndex>
+        : public EventIndexBase<TTransition>
+{
+    using base_type = EventIndexBase<TTransition>;
+    using Range = typename base_type::Range;
+
+public:
+    using typename base_type::event_type;
+    using typename base_type::index_type;
+    using typename base_type::iterator;
+
+    static constexpr bool exact = true;
+
+    void clear()
+    {
+        this->clearBase();
+        m_table.clear();
+    }
+
+    void addState(iterator begin, iterator end)
+    {
+        index_type state = index_type(this->m_eventless.size());
+        auto eventless = this->addEventless(begin, end);
+
+        std::vector<event_type> events;
+        std::vector<std::vector<std::size_t>> positions;
+        base_type::template group<event_type, Identity,
+                                  std::hash<event_type>>(
+                    begin, end, Identity(), events, positions);
+        for (std::size_t idx = 0; idx < events.size(); ++idx)
+        {
+            m_table.emplace(Key{state, events[idx]},
+                            this->addCandidates(begin, positions[idx],
+                                                eventless));
+        }
+    }
+
+    std::pair<iterator, iterator> find(index_type state,
+                                       const event_type& event) const
+    {
+        auto iter = m_table.find(Key{state, event});
+        return iter != m_table.end() ? this->range(iter->second)
+                                     : this->eventless(state);
+    }
+
+private:
+    struct Identity
+    {
+        const event_type& operator()(const event_type& event) const noexcept
+        {
+            return event;
+        }
+    };
+
+    struct Key
+    {
+        index_type state;
+        event_type event;
+
+        bool operator==(const Key& other) const
+        {
+            return state == other.state && event == other.event;
+        }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const
+        {
+            return std::hash<event_type>()(key.event) * 31 + key.state;
+        }
+    };
+
+    std::unordered_map<Key, Range, KeyHash> m_table;
+};
+
+//! \brief An event index for integral events.
+//!
+//! If the events of a state are clustered, the candidates are looked up in
+//! a dense jump table. Otherwise a hash table is used.
+template <typename TTransition>
+class EventIndex<TTransition, IntegralEventIndex>
+        : public EventIndexBase<TTransition>
+{
+    using base_type = EventIndexBase<TTransition>;
+    using Range = typename base_type::Range;
+
+public:
+    using typename base_type::event_type;
+    using typename base_type::index_type;
+    using typename base_type::iterator;
+
+    static constexpr bool exact = true;
+
+    void clear()
+    {
+        this->clearBase();
+        m_dense.clear();
+        m_jumpTable.clear();
+        m_table.clear();
+    }
+
+    void addState(iterator begin, iterator end)
+    {
+        index_type state = index_type(this->m_eventless.size());
+        auto eventless = this->addEventless(begin, end);
+
+        std::vector<std::uintmax_t> keys;
+        std::vector<std::vector<std::size_t>> positions;
+        base_type::template group<std::uintmax_t, KeyFunction,
+                                  std::hash<std::uintmax_t>>(
+                    begin, end, KeyFunction(), keys, positions);
+
+        Dense dense;
+        dense.offset = index_type(m_jumpTable.size());
+        dense.min = 0;
+        dense.size = 0;
+
+        if (!keys.empty())
+        {
+            std::uintmax_t min = keys[0];
+            std::uintmax_t max = keys[0];
+            for (auto key : keys)
+            {
+                if (key < min)
+                    min = key;
+                if (key > max)
+                    max = key;
+            }
+
+            // Use a jump table if at least every third slot is occupied.
+            if (max - min < 3 * keys.size() + 16)
+            {
+                dense.min = min;
+                dense.size = index_type(max - min + 1);
+                m_jumpTable.resize(m_jumpTable.size() + dense.size,
+                                   this->m_eventless[state]);
+            }
+        }
+
+        for (std::size_t idx = 0; idx < keys.size(); ++idx)
+        {
+            Range r = this->addCandidates(begin, positions[idx], eventless);
+            if (dense.size)
+                m_jumpTable[dense.offset + (keys[idx] - dense.min)] = r;
+            else
+                m_table.emplace(Key{state, keys[idx]}, r);
+        }
+
+        m_dense.push_back(dense);
+    }
+
+    std::pair<iterator, iterator> find(index_type state,
+                                       const event_type& event) const
+    {
+        std::uintmax_t key = KeyFunction()(event);
+        const Dense& dense = m_dense[state];
+        if (dense.size)
+        {
+            std::uintmax_t slot = key - dense.min;
+            return slot < dense.size
+                   ? this->range(m_jumpTable[dense.offset + slot])
+                   : this->eventless(state);
+        }
+
+        auto iter = m_table.find(Key{state, key});
+        return iter != m_table.end() ? this->range(iter->second)
+                                     : this->eventless(state);
+    }
+
+private:
+    struct KeyFunction
+    {
+        std::uintmax_t operator()(const event_type& event) const noexcept
+        {
+            return integral_event_key(
+                        event, std::is_enum<event_type>());
+        }
+    };
+
+    struct Dense
+    {
+        std::uintmax_t min;
+        index_type offset;
+        index_type size;
+    };
+
+    struct Key
+    {
+        index_type state;
+        std::uintmax_t key;
+
+        bool operator==(const Key& other) const noexcept
+        {
+            return state == other.state && key == other.key;
+        }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const noexcept
+        {
+            return std::size_t(key.key * 0x9E3779B97F4A7C15ull) ^ key.state;
+        }
+    };
+
+    //! The jump table parameters of every state.
+    std::vector<Dense> m_dense;
+    //! The concatenated jump tables.
+    std::vector<Range> m_jumpTable;
+    //! The lookup table for states with sparse events.
+    std::unordered_map<Key, Range, KeyHash> m_table;
+};
+
+//! \brief An event index for VariantEvents.
+//!
+//! Every state has a jump table with one slot per alternative of the
+//! VariantEvent. The payload of the events is never compared.
+template <typename TTransition>
+class EventIndex<TTransition, VariantEventIndex>
+        : public EventIndexBase<TTransition>
+{
+    using base_type = EventIndexBase<TTransition>;
+    using Range = typename base_type::Range;
+
+public:
+    using typename base_type::event_type;
+    using typename base_type::index_type;
+    using typename base_type::iterator;
+
+    static constexpr bool exact = true;
+
+    void clear()
+    {
+        this->clearBase();
+        m_jumpTable.clear();
+    }
+
+    void addState(iterator begin, iterator end)
+    {
+        index_type state = index_type(this->m_eventless.size());
+        auto eventless = this->addEventless(begin, end);
+
+        std::vector<std::size_t> keys;
+        std::vector<std::vector<std::size_t>> positions;
+        base_type::template group<std::size_t, KeyFunction,
+                                  std::hash<std::size_t>>(
+                    begin, end, KeyFunction(), keys, positions);
+
+        std::size_t offset = m_jumpTable.size();
+        m_jumpTable.resize(offset + event_type::size,
+                           this->m_eventless[state]);
+        for (std::size_t idx = 0; idx < keys.size(); ++idx)
+        {
+            // A transition with an empty event is never triggered.
+            if (keys[idx] >= event_type::size)
+                continue;
+            m_jumpTable[offset + keys[idx]]
+                    = this->addCandidates(begin, positions[idx], eventless);
+        }
+    }
+
+    std::pair<iterator, iterator> find(index_type state,
+                                       const event_type& event) const noexcept
+    {
+        std::size_t alternative = event.index();
+        return alternative < event_type::size
+               ? this->range(m_jumpTable[state * event_type::size
+                                         + alternative])
+               : this->eventless(state);
+    }
+
+private:
+    struct KeyFunction
+    {
+        std::size_t operator()(const event_type& event) const noexcept
+        {
+            return event.index();
+        }
+    };
+
+    //! The concatenated jump tables of all states.
+    std::vector<Range> m_jumpTable;
+};
+
+//! \brief An event index for hierarchical events.
+//!
+//! The events are strings of tokens separated by dots, e.g.
+//! <tt>"net.tcp.reset"</tt>. The event of a transition is an event
+//! descriptor as defined by SCXML: the transition matches every event,
+//! whose leading tokens equal the tokens of the descriptor. So
+//! <tt>"net.tcp"</tt> matches <tt>"net.tcp"</tt> and
+//! <tt>"net.tcp.reset"</tt> but not <tt>"net.tcpip"</tt>. A trailing
+//! <tt>".*"</tt> is ignored and the descriptor <tt>"*"</tt> matches
+//! every event.
+//!
+//! Every state has a trie of the tokens of its descriptors. Every node of
+//! the trie stores only the transitions, whose descriptors end in this
+//! node, such that the memory is linear in the number of transitions. An
+//! event is looked up by following its tokens as far as possible. The
+//! transitions of the nodes along this path and the eventless transitions
+//! are merged into a buffer, which is re-used by the next lookup.
+template <typename TTransition>
+class EventIndex<TTransition, PrefixEventIndex>
+        : public EventIndexBase<TTransition>
+{
+    using base_type = EventIndexBase<TTransition>;
+    using Range = typename base_type::Range;
+
+public:
+    using typename base_type::event_type;
+    using typename base_type::index_type;
+    using typename base_type::iterator;
+
+    static constexpr bool exact = true;
+
+    void clear()
+    {
+        this->clearBase();
+        m_order.clear();
+        m_roots.clear();
+        m_nodes.clear();
+        m_edges.clear();
+        m_path.clear();
+        m_merged.clear();
+    }
+
+    void addState(iterator begin, iterator end)
+    {
+        auto eventless = this->addEventless(begin, end);
+        m_order.insert(m_order.end(), eventless.begin(), eventless.end());
+
+        // Build a temporary trie from the descriptors.
+        std::vector<BuildNode> trie(1);
+        for (iterator iter = begin; iter != end; ++iter)
+        {
+            if ((*iter)->eventless())
+                continue;
+
+            const event_type& descriptor = (*iter)->event();
+            std::size_t length = descriptorLength(descriptor);
+            std::size_t node = 0;
+            std::size_t pos = 0;
+            while (pos < length)
+            {
+                std::size_t last = descriptor.find(separator(), pos);
+                if (last == event_type::npos || last > length)
+                    last = length;
+                auto result = trie[node].children.insert(std::make_pair(
+                                  descriptor.substr(pos, last - pos),
+                                  trie.size()));
+                if (result.second)
+                    trie.emplace_back();
+                node = result.first->second;
+                pos = last + 1;
+            }
+            trie[node].positions.push_back(std::size_t(iter - begin));
+        }
+
+        m_roots.push_back(emit(trie, 0, begin));
+
+        // Reserve the lookup buffers, such that find() does not allocate.
+        // A path visits at most every node of the trie once.
+        m_path.reserve(trie.size() + 1);
+        m_merged.reserve(std::size_t(end - begin));
+    }
+
+    //! Returns the candidate transitions of the \p state for the \p event.
+    //! The returned range is valid until the next call to find().
+    std::pair<iterator, iterator> find(index_type state,
+                                       const event_type& event) const
+    {
+        m_path.clear();
+        addToPath(this->m_eventless[state]);
+
+        index_type node = m_roots[state];
+        addToPath(m_nodes[node].own);
+        std::size_t pos = 0;
+        while (pos < event.size())
+        {
+            std::size_t last = event.find(separator(), pos);
+            if (last == event_type::npos)
+                last = event.size();
+
+            const Node& current = m_nodes[node];
+            auto first = m_edges.begin() + current.firstEdge;
+            auto lastEdge = m_edges.begin() + current.lastEdge;
+            auto edge = std::lower_bound(
+                            first, lastEdge, Token{&event, pos, last - pos},
+                            TokenLess());
+            if (edge == lastEdge
+                || edge->token.compare(0, event_type::npos,
+                                       event, pos, last - pos) != 0)
+            {
+                break;
+            }
+
+            node = edge->node;
+            addToPath(m_nodes[node].own);
+            pos = last + 1;
+        }
+
+        if (m_path.empty())
+            return this->eventless(state);
+        if (m_path.size() == 1)
+            return this->range(m_path[0]);
+        return merge();
+    }
+
+private:
+    using char_type = typename event_type::value_type;
+
+    struct BuildNode
+    {
+        std::map<event_type, std::size_t> children;
+        std::vector<std::size_t> positions;
+    };
+
+    struct Node
+    {
+        //! The transitions, whose descriptors end in this node.
+        Range own;
+        index_type firstEdge;
+        index_type lastEdge;
+    };
+
+    struct Edge
+    {
+        event_type token;
+        index_type node;
+    };
+
+    //! A token in an event, which is looked up without copying it.
+    struct Token
+    {
+        const event_type* event;
+        std::size_t pos;
+        std::size_t length;
+    };
+
+    struct TokenLess
+    {
+        bool operator()(const Edge& edge, const Token& token) const
+        {
+            return edge.token.compare(0, event_type::npos, *token.event,
+                                      token.pos, token.length) < 0;
+        }
+    };
+
+    //! The position of every candidate in the transitions of its state.
+    std::vector<std::size_t> m_order;
+    //! The root node of the trie of every state.
+    std::vector<index_type> m_roots;
+    std::vector<Node> m_nodes;
+    //! The edges of a node are sorted by their token.
+    std::vector<Edge> m_edges;
+    //! The non-empty candidate ranges matched by the current lookup.
+    mutable std::vector<Range> m_path;
+    //! The merged candidates of the current lookup.
+    mutable std::vector<TTransition*> m_merged;
+
+    static char_type separator() noexcept
+    {
+        return char_type('.');
+    }
+
+    //! Returns the length of the \p descriptor without a trailing
+    //! wildcard.
+    static std::size_t descriptorLength(const event_type& descriptor)
+    {
+        std::size_t length = descriptor.size();
+        if (length > 0 && descriptor[length - 1] == char_type('*'))
+        {
+            --length;
+            if (length > 0 && descriptor[length - 1] == separator())
+                --length;
+        }
+        return length;
+    }
+
+    void addToPath(Range r) const noexcept
+    {
+        if (r.first != r.last)
+            m_path.push_back(r);
+    }
+
+    //! Merges the ranges in the path by the position of the transitions in
+    //! their state.
+    std::pair<iterator, iterator> merge() const noexcept
+    {
+        m_merged.clear();
+        while (true)
+        {
+            Range* next = nullptr;
+            for (Range& r : m_path)
+            {
+                if (r.first != r.last
+                    && (!next || m_order[r.first] < m_order[next->first]))
+                {
+                    next = &r;
+                }
+            }
+            if (!next)
+                break;
+            m_merged.push_back(this->m_candidates[next->first++]);
+        }
+        return std::pair<iterator, iterator>(
+                    m_merged.data(), m_merged.data() + m_merged.size());
+    }
+
+    //! Copies the sub-trie rooted at \p idx. Returns the index of the
+    //! copied root.
+    index_type emit(const std::vector<BuildNode>& trie, std::size_t idx,
+                    iterator begin)
+    {
+        const std::vector<std::size_t>& positions = trie[idx].positions;
+
+        index_type node = index_type(m_nodes.size());
+        m_nodes.emplace_back();
+        m_nodes[node].own = this->addCandidates(
+                                begin, positions, std::vector<std::size_t>());
+        m_order.insert(m_order.end(), positions.begin(), positions.end());
+
+        // Reserve the edges before descending such that the edges of a node
+        // are contiguous.
+        index_type firstEdge = index_type(m_edges.size());
+        for (const auto& child : trie[idx].children)
+            m_edges.push_back(Edge{child.first, 0});
+        m_nodes[node].firstEdge = firstEdge;
+        m_nodes[node].lastEdge = index_type(m_edges.size());
+
+        index_type edge = firstEdge;
+        for (const auto& child : trie[idx].children)
+        {
+            index_type childNode = emit(trie, child.second, begin);
+            m_edges[edge++].node = childNode;
+        }
+        return node;
+    }
+};
+
+template <typename TTransition, EventIndexKind TKind>
+constexpr bool EventIndex<TTransition, TKind>::exact;
+
+template <typename TTransition>
+constexpr bool EventIndex<TTransition, HashedEventIndex>::exact;
+
+template <typename TTransition>
+constexpr bool EventIndex<TTransition, IntegralEventIndex>::exact;
+
+template <typename TTransition>
+constexpr bool EventIndex<TTransition, VariantEventIndex>::exact;
+
+template <typename TTransition>
+constexpr bool EventIndex<TTransition, PrefixEventIndex>::exact;
+
+} // namespace fsm11_detail
+} // namespace fsm11
+
+#endif // FSM11_DETAIL_EVENTINDEX_HPP
@@ -0,0 +1,74 @@
+/*******************************************************************************
+  fsm11 - A C++ library for finite state machines
+
+  Copyright (c) 2015-2016, Manuel Freiberger
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  - Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+  - Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#ifndef FSM11_DETAIL_FUTEX_HPP
+#define FSM11_DETAIL_FUTEX_HPP
+
+#include "../statemachine_fwd.hpp"
+
+#ifdef FSM11_USE_WEOS
+#include <weos/atomic.hpp>
+#include <weos/chrono.hpp>
+#else
+#include <atomic>
+#include <chrono>
+#endif // FSM11_USE_WEOS
+
+#include <cstdint>
+
+namespace fsm11
+{
+namespace fsm11_detail
+{
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "A futex word must be a plain 32-bit integer.");
+
+//! \brief Waits on a futex word.
+//!
+//! Blocks the caller as long as the \p word contains the \p expected value
+//! and no wake-up has been sent. The function may return spuriously, so
+//! the caller has to check the word again. On Linux, this is a futex
+//! system call. Elsewhere, the waiters are parked in a small table of
+//! condition variables, which is indexed by the address of the word.
+void futexWait(std::atomic<std::uint32_t>& word, std::uint32_t expected);
+
+//! Waits on a futex word like futexWait() but returns at the latest, when
+//! the \p timeout has expired.
+void futexWaitFor(std::atomic<std::uint32_t>& word, std::uint32_t expected,
+                  std::chrono::nanoseconds timeout);
+
+//! Wakes up all threads, which wait on the \p word. The \p word has to be
+//! modified before. It is not accessed and may have been destroyed
+//! already.
+void futexWakeAll(std::atomic<std::uint32_t>& word);
+
+} // namespace fsm11_detail
+} // namespace fsm11
+
+#endif // FSM11_DETAIL_FUTEX_HPP
@@ -0,0 +1,507 @@
+/*******************************************************************************
+  fsm11 - A C++ library for finite state machines
+
+  Copyright (c) 2015-2016, Manuel Freiberger
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  - Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+  - Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#ifndef FSM11_DETAIL_STATETABLE_HPP
+#define FSM11_DETAIL_STATETABLE_HPP
+
+#include "../statemachine_fwd.hpp"
+#include "eventindex.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace fsm11
+{
+namespace fsm11_detail
+{
+
+// ----=====================================================================----
+//     StateTable
+// ----=====================================================================----
+
+//! \brief A flat representation of a state hierarchy.
+//!
+//! The StateTable compiles a hierarchy of states into contiguous arrays,
+//! which are indexed by the position of a state in a pre-order traversal.
+//! For every state, the table stores the index of its parent, the end of
+//! its sub-tree, its depth and a range of originating transitions. As the
+//! sub-tree of a state occupies the consecutive indices
+//! <tt>[index, subtreeEnd)</tt>, the dispatcher can walk sub-trees with a
+//! simple loop instead of following the links between the states.
+//!
+//! Ancestor queries are answered in constant time by checking if the
+//! index of the descendant lies in the sub-tree interval of the ancestor.
+//! The least common ancestor is found in logarithmic time with binary
+//! lifting, i.e. for every state the table stores its ancestors at the
+//! distances 1, 2, 4, 8 and so on.
+//!
+//! In addition, the table contains an EventIndex, which maps an event to
+//! the transitions of a state, which can be triggered by this event.
+//!
+//! The table has to be rebuilt whenever the hierarchy or the set of
+//! transitions changes.
+template <typename TStateMachine>
+class StateTable
+{
+public:
+    using state_type = State<TStateMachine>;
+    using transition_type = Transition<TStateMachine>;
+    using index_type = std::uint32_t;
+    using event_type = typename transition_type::event_type;
+    using event_index_type = EventIndex<
+                                 transition_type,
+                                 get_options<TStateMachine>::type::hierarchical_event_matching
+                                 ? PrefixEventIndex
+                                 : get_event_index_kind<event_type>::value>;
+    using transition_iterator = transition_type* const*;
+    using transition_range = std::pair<transition_iterator,
+                                       transition_iterator>;
+
+    //! Set if the ranges returned from candidateTransitions() contain only
+    //! transitions which are eventless or whose event matches. Otherwise,
+    //! the caller has to compare the events.
+    static constexpr bool exact_event_match = event_index_type::exact;
+
+    //! The index of a non-existing state (e.g. the parent of the root).
+    static constexpr index_type npos = index_type(-1);
+
+    StateTable() noexcept
+        : m_levels(0),
+          m_generation(0),
+          m_valid(false)
+    {
+    }
+
+    StateTable(const StateTable&) = delete;
+    StateTable& operator=(const StateTable&) = delete;
+
+    //! \brief Builds the table.
+    //!
+    //! Compiles the hierarchy rooted at \p root into this table.
+    void build(state_type& root);
+
+    //! \brief Returns the generation of the table.
+    //!
+    //! The generation is incremented whenever the table is rebuilt. It
+    //! is never zero for a built table, so data derived from the table can
+    //! be tagged with it.
+    std::uint32_t generation() const noexcept
+    {
+        return m_generation;
+    }
+
+    //! Checks if the table is up to date.
+    bool valid() const noexcept
+    {
+        return m_valid;
+    }
+
+    //! Marks the table as outdated.
+    void invalidate() noexcept
+    {
+        m_valid = false;
+    }
+
+    //! Returns the number of states in the table.
+    index_type size() const noexcept
+    {
+        return index_type(m_states.size());
+    }
+
+    //! Returns the state at the pre-order index \p idx.
+    state_type* state(index_type idx) const noexcept
+    {
+        return m_states[idx];
+    }
+
+    //! Returns the index of the parent of the state \p idx.
+    index_type parent(index_type idx) const noexcept
+    {
+        return m_nodes[idx].parent;
+    }
+
+    //! Returns the index past the last descendant of the state \p idx.
+    index_type subtreeEnd(index_type idx) const noexcept
+    {
+        return m_nodes[idx].subtreeEnd;
+    }
+
+    //! Returns the depth of the state \p idx. The root has depth zero.
+    index_type depth(index_type idx) const noexcept
+    {
+        return m_nodes[idx].depth;
+    }
+
+    //! Returns the post-order rank of the state \p idx.
+    index_type postOrderRank(index_type idx) const noexcept
+    {
+        return m_nodes[idx].postOrderRank;
+    }
+
+    //! Returns the index of the state with the post-order \p rank.
+    index_type postOrder(index_type rank) const noexcept
+    {
+        return m_postOrder[rank];
+    }
+
+    bool isAtomic(index_type idx) const noexcept
+    {
+        return m_nodes[idx].flags & Atomic;
+    }
+
+    bool isCompound(index_type idx) const noexcept
+    {
+        return m_nodes[idx].flags & Compound;
+    }
+
+    bool isParallel(index_type idx) const noexcept
+    {
+        return m_nodes[idx].flags & Parallel;
+    }
+
+    //! Returns \p true, if the state \p idx has an eventless transition.
+    bool hasEventlessTransitions(index_type idx) const noexcept
+    {
+        return m_nodes[idx].flags & HasEventless;
+    }
+
+    //! Returns \p true, if the state \p idx or one of its descendants has
+    //! an eventless transition.
+    bool subtreeHasEventlessTransitions(index_type idx) const noexcept
+    {
+        return m_nodes[idx].flags & SubtreeHasEventless;
+    }
+
+    //! Checks if the \p state is part of this table.
+    bool contains(const state_type* state) const noexcept
+    {
+        return state->m_index < size() && m_states[state->m_index] == state;
+    }
+
+    //! Returns \p true, if the state \p ancestor is an ancestor of the
+    //! state \p descendant. Every state is its own ancestor.
+    bool isAncestor(index_type ancestor, index_type descendant) const noexcept
+    {
+        return ancestor <= descendant
+               && descendant < m_nodes[ancestor].subtreeEnd;
+    }
+
+    //! Returns the least common ancestor of the states \p idx1 and \p idx2.
+    index_type leastCommonAncestor(index_type idx1,
+                                   index_type idx2) const noexcept;
+
+    //! Returns the least common proper ancestor of the states \p idx1 and
+    //! \p idx2 or npos, if there is none.
+    index_type leastCommonProperAncestor(index_type idx1,
+                                         index_type idx2) const noexcept
+    {
+        index_type lca = leastCommonAncestor(idx1, idx2);
+        return lca == idx1 || lca == idx2 ? m_nodes[lca].parent : lca;
+    }
+
+    //! Returns the first transition originating from the state \p idx.
+    transition_type* const* beginTransitions(index_type idx) const noexcept
+    {
+        return m_transitions.data() + m_nodes[idx].firstTransition;
+    }
+
+    //! Returns past the last transition originating from the state \p idx.
+    transition_type* const* endTransitions(index_type idx) const noexcept
+    {
+        return m_transitions.data() + m_nodes[idx].lastTransition;
+    }
+
+    //! Returns the transitions of the state \p idx, which may be triggered
+    //! by the \p event. The transitions are in the order in which they
+    //! have been added to the state. The range is valid until the next
+    //! call of this function.
+    transition_range candidateTransitions(index_type idx,
+                                          const event_type& event) const
+    {
+        return m_eventIndex.find(idx, event);
+    }
+
+    //! Checks if a candidate transition with the event \p transitionEvent
+    //! is triggered by the \p event.
+    static bool eventMatches(const event_type& transitionEvent,
+                             const event_type& event)
+    {
+        return event_index_type::matches(transitionEvent, event);
+    }
+
+    //! Returns the eventless transitions of the state \p idx.
+    transition_range eventlessTransitions(index_type idx) const noexcept
+    {
+        return m_eventIndex.eventless(idx);
+    }
+
+    //! Returns \p true, if the state \p idx has a timeout transition.
+    bool hasTimeoutTransitions(index_type idx) const noexcept
+    {
+        return m_nodes[idx].flags & HasTimeout;
+    }
+
+    //! Returns the timeout transitions of the state \p idx. They are not
+    //! part of the event index.
+    transition_range timeoutTransitions(index_type idx) const noexcept
+    {
+        return transition_range(
+                    m_timeoutTransitions.data() + m_nodes[idx].firstTimeout,
+                    m_timeoutTransitions.data() + m_nodes[idx].lastTimeout);
+    }
+
+private:
+    enum NodeFlags
+    {
+        Atomic              = 0x01,
+        Compound            = 0x02,
+        Parallel            = 0x04,
+        HasEventless        = 0x08,
+        SubtreeHasEventless = 0x10,
+        HasTimeout          = 0x20
+    };
+
+    //! The static properties of a single state.
+    struct Node
+    {
+        index_type parent;
+        index_type subtreeEnd;
+        index_type depth;
+        index_type postOrderRank;
+        index_type firstTransition;
+        index_type lastTransition;
+        index_type firstTimeout;
+        index_type lastTimeout;
+        int flags;
+    };
+
+    //! The states in pre-order.
+    std::vector<state_type*> m_states;
+    //! The nodes with the same indices as the states.
+    std::vector<Node> m_nodes;
+    //! Maps a post-order rank to a pre-order index.
+    std::vector<index_type> m_postOrder;
+    //! The transitions grouped by their source state in pre-order.
+    std::vector<transition_type*> m_transitions;
+    //! The timeout transitions grouped by their source state in pre-order.
+    std::vector<transition_type*> m_timeoutTransitions;
+    //! The number of levels of the binary lifting table.
+    index_type m_levels;
+    //! The element <tt>idx * m_levels + k</tt> is the ancestor of the state
+    //! \p idx at the distance 2^k. The root is its own ancestor.
+    std::vector<index_type> m_ancestors;
+    //! Maps the events to the candidate transitions of every state.
+    event_index_type m_eventIndex;
+    //! The number of builds.
+    std::uint32_t m_generation;
+    //! Set if the table reflects the current hierarchy.
+    bool m_valid;
+};
+
+template <typename TStateMachine>
+constexpr typename StateTable<TStateMachine>::index_type
+StateTable<TStateMachine>::npos;
+
+template <typename TStateMachine>
+constexpr bool StateTable<TStateMachine>::exact_event_match;
+
+template <typename TStateMachine>
+void StateTable<TStateMachine>::build(state_type& root)
+{
+    m_valid = false;
+    m_states.clear();
+    m_nodes.clear();
+    m_postOrder.clear();
+    m_transitions.clear();
+    m_timeoutTransitions.clear();
+    m_ancestors.clear();
+    m_eventIndex.clear();
+    if (++m_generation == 0)
+        ++m_generation;
+
+    for (auto iter = root.pre_order_begin(); iter != root.pre_order_end();
+         ++iter)
+    {
+        state_type* state = &*iter;
+        index_type idx = index_type(m_states.size());
+        state->m_index = idx;
+
+        Node node;
+        if (state == &root)
+        {
+            node.parent = npos;
+            node.depth = 0;
+        }
+        else
+        {
+            node.parent = state->parent()->m_index;
+            node.depth = m_nodes[node.parent].depth + 1;
+        }
+        node.subtreeEnd = idx + 1;
+        node.postOrderRank = 0;
+        node.flags = state->isAtomic() ? Atomic
+                                       : state->isCompound() ? Compound
+                                                             : Parallel;
+
+        node.firstTransition = index_type(m_transitions.size());
+        node.firstTimeout = index_type(m_timeoutTransitions.size());
+        for (auto transition = state->beginTransitions();
+             transition != state->endTransitions(); ++transition)
+        {
+            // A timeout transition is triggered by its timer only and
+            // is kept out of the event index.
+            if (transition->hasTimeout())
+            {
+                m_timeoutTransitions.push_back(&*transition);
+                node.flags |= HasTimeout;
+                continue;
+            }
+
+            m_transitions.push_back(&*transition);
+            if (transition->eventless())
+                node.flags |= HasEventless | SubtreeHasEventless;
+        }
+        node.lastTransition = index_type(m_transitions.size());
+        node.lastTimeout = index_type(m_timeoutTransitions.size());
+
+        m_states.push_back(state);
+        m_nodes.push_back(node);
+    }
+
+    // Propagate the end of the sub-trees and the eventless summary from the
+    // leaves to the root. As a parent always precedes its children, a
+    // single backwards pass suffices.
+    for (index_type idx = size(); idx-- > 1; )
+    {
+        Node& parent = m_nodes[m_nodes[idx].parent];
+        if (parent.subtreeEnd < m_nodes[idx].subtreeEnd)
+            parent.subtreeEnd = m_nodes[idx].subtreeEnd;
+        parent.flags |= m_nodes[idx].flags & SubtreeHasEventless;
+    }
+
+    m_postOrder.reserve(m_states.size());
+    for (auto iter = root.post_order_begin(); iter != root.post_order_end();
+         ++iter)
+    {
+        m_nodes[iter->m_index].postOrderRank = index_type(m_postOrder.size());
+        m_postOrder.push_back(iter->m_index);
+    }
+
+    for (index_type idx = 0; idx < size(); ++idx)
+        m_eventIndex.addState(beginTransitions(idx), endTransitions(idx));
+
+    index_type maxDepth = 0;
+    for (const Node& node : m_nodes)
+    {
+        if (node.depth > maxDepth)
+            maxDepth = node.depth;
+    }
+    m_levels = 1;
+    while ((index_type(1) << m_levels) <= maxDepth)
+        ++m_levels;
+
+    // The ancestors of a parent are known before those of its children.
+    m_ancestors.resize(std::size_t(size()) * m_levels);
+    for (index_type idx = 0; idx < size(); ++idx)
+    {
+        index_type* ancestors = &m_ancestors[std::size_t(idx) * m_levels];
+        ancestors[0] = idx == 0 ? 0 : m_nodes[idx].parent;
+        for (index_type k = 1; k < m_levels; ++k)
+        {
+            ancestors[k] = m_ancestors[std::size_t(ancestors[k - 1]) * m_levels
+                                       + k - 1];
+        }
+    }
+
+    m_valid = true;
+}
+
+template <typename TStateMachine>
+auto StateTable<TStateMachine>::leastCommonAncestor(
+        index_type idx1, index_type idx2) const noexcept -> index_type
+{
+    if (isAncestor(idx1, idx2))
+        return idx1;
+    if (isAncestor(idx2, idx1))
+        return idx2;
+
+    // Lift the first state as long as it does not contain the second one.
+    for (index_type k = m_levels; k-- > 0; )
+    {
+        index_type ancestor = m_ancestors[std::size_t(idx1) * m_levels + k];
+        if (!isAncestor(ancestor, idx2))
+            idx1 = ancestor;
+    }
+    return m_nodes[idx1].parent;
+}
+
+// ----=====================================================================----
+//     StateTableLookup
+// ----=====================================================================----
+
+//! \brief Finds the state table of two states.
+//!
+//! The free functions like isAncestor() use the state table of the
+//! state machine, if both states belong to it and the table is up to date.
+//! Otherwise, they fall back to following the parent links.
+template <typename TStateMachine>
+struct StateTableLookup
+{
+    using state_type = State<TStateMachine>;
+    using table_type = StateTable<TStateMachine>;
+    using index_type = typename table_type::index_type;
+
+    //! Returns the table, which contains the states \p state1 and
+    //! \p state2, and stores their indices in \p idx1 and \p idx2. If
+    //! there is no such table, a null-pointer is returned.
+    static const table_type* find(const state_type* state1,
+                                  const state_type* state2,
+                                  index_type& idx1, index_type& idx2) noexcept
+    {
+        const TStateMachine* sm = state1->stateMachine();
+        if (!sm || sm != state2->stateMachine())
+            return nullptr;
+
+        const table_type& table = sm->m_stateTable;
+        if (!table.valid() || !table.contains(state1)
+            || !table.contains(state2))
+        {
+            return nullptr;
+        }
+
+        idx1 = state1->m_index;
+        idx2 = state2->m_index;
+        return &table;
+    }
+};
+
+} // namespace fsm11_detail
+} // namespace fsm11
+
+#endif // FSM11_DETAIL_STATETABLE_HPP
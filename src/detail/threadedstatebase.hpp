@@ -31,12 +31,104 @@
 
 #include "../statemachine_fwd.hpp"
 #include "../exitrequest.hpp"
+#include "futex.hpp"
+
+#ifdef FSM11_USE_WEOS
+#include <weos/atomic.hpp>
+#include <weos/exception.hpp>
+#else
+#include <atomic>
+#include <exception>
+#endif // FSM11_USE_WEOS
+
+#include <cstdint>
 
 namespace fsm11
 {
 namespace fsm11_detail
 {
 
+//! \brief A handle to an invoke action.
+//!
+//! The handle tracks one invocation of a threaded state. It replaces a
+//! promise/future pair but lives inside the state, such that starting and
+//! joining an invoke action does not need a shared state on the heap. The
+//! joining thread sleeps on a futex until the invoke action completes.
+class InvokeHandle
+{
+public:
+    InvokeHandle() noexcept
+        : m_state(Idle)
+    {
+    }
+
+    InvokeHandle(const InvokeHandle&) = delete;
+    InvokeHandle& operator=(const InvokeHandle&) = delete;
+
+    //! Marks the invoke action as started.
+    void start() noexcept
+    {
+        m_state.store(Running, std::memory_order_release);
+    }
+
+    //! Marks the invoke action as completed and stores the \p exception,
+    //! which it has thrown. A thread blocked in join() is woken up. The
+    //! handle must not be accessed after this call because the joiner
+    //! is free to destroy it.
+    void complete(std::exception_ptr exception = nullptr) noexcept
+    {
+        m_exception = std::move(exception);
+        if (m_state.exchange(Done, std::memory_order_acq_rel) == Waiting)
+            futexWakeAll(m_state);
+    }
+
+    //! Returns \p true, if the invoke action has completed but has not
+    //! been joined, yet.
+    bool ready() const noexcept
+    {
+        return m_state.load(std::memory_order_acquire) == Done;
+    }
+
+    //! Waits until the invoke action has completed. If the action has
+    //! thrown an exception, it is rethrown.
+    void join()
+    {
+        std::uint32_t state = m_state.load(std::memory_order_acquire);
+        while (state == Running || state == Waiting)
+        {
+            if (state == Running
+                && !m_state.compare_exchange_weak(state, Waiting,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_acquire))
+            {
+                continue;
+            }
+            futexWait(m_state, Waiting);
+            state = m_state.load(std::memory_order_acquire);
+        }
+
+        m_state.store(Idle, std::memory_order_relaxed);
+        if (m_exception)
+        {
+            std::exception_ptr exception = std::move(m_exception);
+            m_exception = nullptr;
+            std::rethrow_exception(exception);
+        }
+    }
+
+private:
+    enum : std::uint32_t
+    {
+        Idle,
+        Running,
+        Waiting,
+        Done
+    };
+
+    std::atomic<std::uint32_t> m_state;
+    std::exception_ptr m_exception;
+};
+
 class ThreadedStateBase
 {
 public:
@@ -48,10 +140,17 @@ public:
 
 protected:
     ExitRequest m_exitRequest;
+    //! The handle of the current invocation.
+    InvokeHandle m_invokeHandle;
+    //! A link to the next state in the queue of a thread pool.
+    ThreadedStateBase* m_nextTask = nullptr;
 
     template <std::size_t TSize>
     friend class fsm11::ThreadPool;
 
+    template <std::size_t TMinSize, std::size_t TMaxSize>
+    friend class fsm11::ElasticThreadPool;
+
     friend class WithoutThreadPool;
 };
 
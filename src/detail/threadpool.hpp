@@ -34,6 +34,16 @@
 #include "threadedstatebase.hpp"
 #include "../threadpool.hpp"
 
+#ifdef FSM11_USE_WEOS
+#include <weos/memory.hpp>
+#include <weos/type_traits.hpp>
+#include <weos/utility.hpp>
+#else
+#include <memory>
+#include <type_traits>
+#include <utility>
+#endif // FSM11_USE_WEOS
+
 namespace fsm11
 {
 namespace fsm11_detail
@@ -53,10 +63,52 @@ template <typename TOptions>
 class WithThreadPool
 {
 public:
-    using thread_pool_type = ThreadPool<TOptions::thread_pool_size>;
+    using thread_pool_type = typename std::conditional<
+                                 TOptions::thread_pool_max_size == 0,
+                                 ThreadPool<TOptions::thread_pool_size>,
+                                 ElasticThreadPool<TOptions::thread_pool_size,
+                                                   TOptions::thread_pool_max_size>
+                             >::type;
 
 protected:
     using internal_thread_pool_type = thread_pool_type;
+
+    //! Creates a thread pool, which is owned by the state machine.
+    WithThreadPool()
+        : m_threadPool(std::make_shared<thread_pool_type>())
+    {
+    }
+
+    //! Takes over the \p pool.
+    explicit
+    WithThreadPool(thread_pool_type&& pool)
+        : m_threadPool(std::make_shared<thread_pool_type>(std::move(pool)))
+    {
+    }
+
+    //! Uses the \p pool without owning it.
+    explicit
+    WithThreadPool(thread_pool_type& pool)
+        : m_threadPool(std::shared_ptr<thread_pool_type>(), &pool)
+    {
+    }
+
+    //! Shares the ownership of the \p pool.
+    explicit
+    WithThreadPool(std::shared_ptr<thread_pool_type> pool)
+        : m_threadPool(std::move(pool))
+    {
+    }
+
+    thread_pool_type& threadPool() noexcept
+    {
+        return *m_threadPool;
+    }
+
+private:
+    //! The pool, in which the invoke actions are run. A pool, which has been
+    //! passed by reference, is referenced without ownership.
+    std::shared_ptr<thread_pool_type> m_threadPool;
 };
 
 template <typename TOptions>
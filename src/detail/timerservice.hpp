@@ -0,0 +1,379 @@
+/*******************************************************************************
+  fsm11 - A C++ library for finite state machines
+
+  Copyright (c) 2015-2016, Manuel Freiberger
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  - Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+  - Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#ifndef FSM11_DETAIL_TIMERSERVICE_HPP
+#define FSM11_DETAIL_TIMERSERVICE_HPP
+
+#include "../statemachine_fwd.hpp"
+#include "../transition.hpp"
+#include "timerwheel.hpp"
+
+#ifdef FSM11_USE_WEOS
+#include <weos/chrono.hpp>
+#include <weos/mutex.hpp>
+#include <weos/type_traits.hpp>
+#include <weos/utility.hpp>
+#else
+#include <chrono>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#endif // FSM11_USE_WEOS
+
+#include <cstdint>
+#include <vector>
+
+namespace fsm11
+{
+namespace fsm11_detail
+{
+
+// ----=====================================================================----
+//     Timer service
+// ----=====================================================================----
+
+//! \brief An armed timer.
+//!
+//! A timer either sends an event or triggers a timeout transition. The
+//! latter is outdated, if the generation of the transition has changed.
+template <typename TDerived>
+struct TimerEntry
+{
+    using event_type = typename get_options<TDerived>::type::event_type;
+    using transition_type = Transition<TDerived>;
+
+    TimerEntry()
+        : transition(nullptr),
+          generation(0)
+    {
+    }
+
+    explicit
+    TimerEntry(event_type&& ev)
+        : event(std::move(ev)),
+          transition(nullptr),
+          generation(0)
+    {
+    }
+
+    TimerEntry(transition_type* t, std::uint32_t g)
+        : event(),
+          transition(t),
+          generation(g)
+    {
+    }
+
+    event_type event;
+    //! The timeout transition or a null-pointer, if the timer sends the event.
+    transition_type* transition;
+    std::uint32_t generation;
+};
+
+template <typename TDerived>
+class WithoutTimerService
+{
+public:
+    using options = typename get_options<TDerived>::type;
+    using event_type = typename options::event_type;
+
+    template <typename T = void, typename... TArgs>
+    TimerHandle sendAfter(TArgs&&...)
+    {
+        static_assert(!std::is_same<T, T>::value,
+                      "The timer service is disabled");
+        return TimerHandle();
+    }
+
+    template <typename T = void, typename... TArgs>
+    TimerHandle sendAt(TArgs&&...)
+    {
+        static_assert(!std::is_same<T, T>::value,
+                      "The timer service is disabled");
+        return TimerHandle();
+    }
+
+    template <typename T = void>
+    bool cancelTimer(const TimerHandle&)
+    {
+        static_assert(!std::is_same<T, T>::value,
+                      "The timer service is disabled");
+        return false;
+    }
+
+    template <typename T = void, typename... TArgs>
+    std::size_t processTimers(TArgs&&...)
+    {
+        static_assert(!std::is_same<T, T>::value,
+                      "The timer service is disabled");
+        return 0;
+    }
+
+protected:
+    using timer_time_point = std::chrono::steady_clock::time_point;
+    using timer_entry_type = TimerEntry<TDerived>;
+
+    //! The event loop waits without a deadline.
+    inline
+    timer_time_point collectExpiredTimers(std::vector<timer_entry_type>&)
+    {
+        return timer_time_point::max();
+    }
+
+    inline
+    void armTimeout(Transition<TDerived>*)
+    {
+    }
+
+    inline
+    void cancelTimeout(Transition<TDerived>*)
+    {
+    }
+};
+
+template <typename TDerived>
+class WithTimerService
+{
+public:
+    using options = typename get_options<TDerived>::type;
+    using event_type = typename options::event_type;
+    using clock_type = typename options::timer_clock_type;
+    using time_point = typename clock_type::time_point;
+    using tick_duration = typename options::timer_tick_type;
+
+    WithTimerService()
+        : m_epoch(clock_type::now()),
+          m_wakeUpTick(no_tick)
+    {
+    }
+
+    //! \brief Sends an event after a delay.
+    //!
+    //! Arms a timer, which adds the \p event to the state machine after the
+    //! given \p delay has elapsed. Returns a handle to cancel the timer.
+    template <typename TRep, typename TPeriod>
+    TimerHandle sendAfter(event_type event,
+                          const std::chrono::duration<TRep, TPeriod>& delay)
+    {
+        return sendAt(std::move(event), clock_type::now() + delay);
+    }
+
+    //! \brief Sends an event at a point in time.
+    //!
+    //! Arms a timer, which adds the \p event to the state machine when the
+    //! \p expiry time has been reached. The timer expires with the first
+    //! tick after this time. Returns a handle to cancel the timer.
+    template <typename TDuration>
+    TimerHandle sendAt(event_type event,
+                       const std::chrono::time_point<clock_type, TDuration>& expiry)
+    {
+        return arm(timer_entry_type(std::move(event)), expiry);
+    }
+
+    //! \brief Cancels a timer.
+    //!
+    //! Cancels the timer referred to by the \p handle. Returns \p true, if
+    //! the timer has been armed. If it has expired already, the state
+    //! machine might still have to dispatch the timer's event.
+    bool cancelTimer(const TimerHandle& handle)
+    {
+        std::lock_guard<std::mutex> lock(m_timerMutex);
+        return m_timerWheel.cancel(handle);
+    }
+
+    //! \brief Processes the expired timers.
+    //!
+    //! Adds the events of all timers, which have expired until \p now, to
+    //! the state machine and returns their number. This function is the
+    //! driver of the timers of a synchronous state machine and has to be
+    //! called periodically or at the time returned by nextTimerExpiry().
+    //! It must not be called concurrently.
+    std::size_t processTimers(time_point now)
+    {
+        m_expiredTimers.clear();
+        collectExpiredTimers(now, m_expiredTimers);
+        derived().dispatchTimers(m_expiredTimers);
+        return m_expiredTimers.size();
+    }
+
+    //! Processes the timers, which have expired until the current time.
+    std::size_t processTimers()
+    {
+        return processTimers(clock_type::now());
+    }
+
+    //! \brief Returns the time of the next expiry.
+    //!
+    //! Returns the time at which the next timer expires. The returned time
+    //! may be earlier, if the timer wheel has to be re-organized. If no
+    //! timer is armed, <tt>time_point::max()</tt> is returned.
+    time_point nextTimerExpiry() const
+    {
+        std::lock_guard<std::mutex> lock(m_timerMutex);
+        if (m_timerWheel.empty())
+            return time_point::max();
+        return toTimePoint(m_timerWheel.nextTick());
+    }
+
+protected:
+    using timer_time_point = time_point;
+    using timer_entry_type = TimerEntry<TDerived>;
+
+    //! Appends the timers, which have expired until the current time, to
+    //! \p timers. Returns the time of the next expiry.
+    timer_time_point collectExpiredTimers(std::vector<timer_entry_type>& timers)
+    {
+        return collectExpiredTimers(clock_type::now(), timers);
+    }
+
+    //! Appends the timers, which have expired until \p now, to \p timers.
+    //! Returns the time of the next expiry.
+    timer_time_point collectExpiredTimers(time_point now,
+                                          std::vector<timer_entry_type>& timers)
+    {
+        using namespace std::chrono;
+
+        auto elapsed = duration_cast<tick_duration>(now - m_epoch);
+        std::lock_guard<std::mutex> lock(m_timerMutex);
+        if (elapsed.count() > 0)
+        {
+            m_timerWheel.advance(tick_type(elapsed.count()),
+                                 [&](timer_entry_type&& timer) {
+                timers.push_back(std::move(timer));
+            });
+        }
+
+        if (m_timerWheel.empty())
+        {
+            m_wakeUpTick = no_tick;
+            return time_point::max();
+        }
+        m_wakeUpTick = m_timerWheel.nextTick();
+        return toTimePoint(m_wakeUpTick);
+    }
+
+    //! Arms the timer of the timeout \p transition, whose source state
+    //! has just been entered.
+    void armTimeout(Transition<TDerived>* transition)
+    {
+        using clock_duration = typename clock_type::duration;
+
+        auto delay = std::chrono::duration_cast<clock_duration>(
+                         transition->m_timeout);
+        if (delay < transition->m_timeout)
+            ++delay;
+        std::uint32_t generation = ++transition->m_timeoutGeneration;
+        transition->m_timeoutTimer = arm(
+                timer_entry_type(transition, generation),
+                clock_type::now() + delay);
+    }
+
+    //! Cancels the timer of the timeout \p transition, whose source state
+    //! is left.
+    void cancelTimeout(Transition<TDerived>* transition)
+    {
+        ++transition->m_timeoutGeneration;
+        cancelTimer(transition->m_timeoutTimer);
+    }
+
+private:
+    using tick_type = typename TimerWheel<timer_entry_type>::tick_type;
+
+    static constexpr tick_type no_tick = tick_type(-1);
+
+    //! The time of tick zero.
+    time_point m_epoch;
+    //! A mutex to protect the timer wheel.
+    mutable std::mutex m_timerMutex;
+    TimerWheel<timer_entry_type> m_timerWheel;
+    //! The tick at which the timers are processed next.
+    tick_type m_wakeUpTick;
+    //! A buffer for the expired timers.
+    std::vector<timer_entry_type> m_expiredTimers;
+
+    //! Arms the \p timer, which expires at \p expiry.
+    template <typename TDuration>
+    TimerHandle arm(timer_entry_type&& timer,
+                    const std::chrono::time_point<clock_type, TDuration>& expiry)
+    {
+        using namespace std::chrono;
+
+        auto delay = duration_cast<tick_duration>(expiry - m_epoch);
+        if (m_epoch + delay < expiry)
+            ++delay;
+        tick_type tick = delay.count() > 0 ? tick_type(delay.count()) : 0;
+
+        TimerHandle handle;
+        bool wakeUp = false;
+        {
+            std::lock_guard<std::mutex> lock(m_timerMutex);
+            handle = m_timerWheel.schedule(tick, std::move(timer));
+            // Only notify the event loop if the timer expires before the
+            // event loop wakes up anyway.
+            tick = tick > m_timerWheel.now() ? tick : m_timerWheel.now() + 1;
+            if (tick < m_wakeUpTick)
+            {
+                m_wakeUpTick = tick;
+                wakeUp = true;
+            }
+        }
+
+        if (wakeUp)
+            derived().wakeUpForTimers();
+        return handle;
+    }
+
+    time_point toTimePoint(tick_type tick) const
+    {
+        return m_epoch + std::chrono::duration_cast<typename clock_type::duration>(
+                             tick_duration(tick));
+    }
+
+    //! Casts this instance to the derived class.
+    TDerived& derived()
+    {
+        return *static_cast<TDerived*>(this);
+    }
+};
+
+template <typename TDerived>
+constexpr typename WithTimerService<TDerived>::tick_type
+WithTimerService<TDerived>::no_tick;
+
+template <typename TOptions>
+struct get_timer_service
+{
+    using type = typename std::conditional<
+                     TOptions::timer_service_enable,
+                     WithTimerService<StateMachineImpl<TOptions>>,
+                     WithoutTimerService<StateMachineImpl<TOptions>>>::type;
+};
+
+} // namespace fsm11_detail
+} // namespace fsm11
+
+#endif // FSM11_DETAIL_TIMERSERVICE_HPP
@@ -0,0 +1,438 @@
+/*******************************************************************************
+  fsm11 - A C++ library for finite state machines
+
+  Copyright (c) 2015-2016, Manuel Freiberger
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  - Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+  - Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#ifndef FSM11_DETAIL_TIMERWHEEL_HPP
+#define FSM11_DETAIL_TIMERWHEEL_HPP
+
+#include "../statemachine_fwd.hpp"
+
+#ifdef FSM11_USE_WEOS
+#include <weos/utility.hpp>
+#else
+#include <utility>
+#endif // FSM11_USE_WEOS
+
+#include <cstdint>
+#include <vector>
+
+namespace fsm11
+{
+namespace fsm11_detail
+{
+template <typename TPayload>
+class TimerWheel;
+} // namespace fsm11_detail
+
+//! \brief A handle to a timer.
+//!
+//! The handle is returned when a timer is armed and is needed to cancel
+//! the timer. It is a plain value and stays valid, when the timer has
+//! expired or has been cancelled. Cancelling such a timer has no effect.
+class TimerHandle
+{
+public:
+    //! Creates a handle, which does not refer to any timer.
+    TimerHandle() noexcept
+        : m_index(std::uint32_t(-1)),
+          m_generation(0)
+    {
+    }
+
+    bool operator==(const TimerHandle& other) const noexcept
+    {
+        return m_index == other.m_index && m_generation == other.m_generation;
+    }
+
+    bool operator!=(const TimerHandle& other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+private:
+    TimerHandle(std::uint32_t index, std::uint32_t generation) noexcept
+        : m_index(index),
+          m_generation(generation)
+    {
+    }
+
+    std::uint32_t m_index;
+    std::uint32_t m_generation;
+
+    template <typename TPayload>
+    friend class fsm11_detail::TimerWheel;
+};
+
+namespace fsm11_detail
+{
+
+// ----=====================================================================----
+//     TimerWheel
+// ----=====================================================================----
+
+//! \brief A hierarchical timer wheel.
+//!
+//! The wheel stores timers, which expire at a certain tick. It has four
+//! levels with 256 slots each. The slots of level \p k span
+//! <tt>256^k</tt> ticks. A timer is put into the lowest level, in which its
+//! expiry tick shares the higher digits with the current tick. When the
+//! current tick reaches the span of a slot in a higher level, the timers
+//! of this slot are cascaded down. Timers, which are more than
+//! <tt>2^32</tt> ticks ahead, are kept in an overflow list.
+//!
+//! The timers are nodes in a pool and are linked by indices. Arming and
+//! cancelling a timer takes constant time. A bitmap of the occupied slots
+//! lets advance() skip empty slots, so the time needed to advance the
+//! wheel does not depend on the number of elapsed ticks.
+template <typename TPayload>
+class TimerWheel
+{
+public:
+    using tick_type = std::uint64_t;
+
+    TimerWheel() noexcept
+        : m_now(0),
+          m_size(0),
+          m_freeList(npos)
+    {
+        for (auto& head : m_heads)
+            head = npos;
+        for (auto& tail : m_tails)
+            tail = npos;
+        for (auto& word : m_occupied)
+            word = 0;
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    //! Returns the current tick. All timers up to this tick have expired.
+    tick_type now() const noexcept
+    {
+        return m_now;
+    }
+
+    //! Returns the number of armed timers.
+    std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    //! Returns \p true, if no timer is armed.
+    bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    //! \brief Arms a timer.
+    //!
+    //! Arms a timer carrying the \p payload, which expires at the tick
+    //! \p expiry. If this tick has already passed, the timer expires with
+    //! the next tick. Timers with the same expiry tick expire in the order
+    //! in which they have been armed.
+    TimerHandle schedule(tick_type expiry, TPayload payload)
+    {
+        std::uint32_t idx;
+        if (m_freeList != npos)
+        {
+            idx = m_freeList;
+            m_freeList = m_nodes[idx].next;
+        }
+        else
+        {
+            idx = std::uint32_t(m_nodes.size());
+            m_nodes.emplace_back();
+            m_nodes[idx].generation = 0;
+        }
+
+        Node& node = m_nodes[idx];
+        node.expiry = expiry > m_now ? expiry : m_now + 1;
+        node.payload = std::move(payload);
+        node.armed = true;
+        link(idx);
+        ++m_size;
+        return TimerHandle(idx, node.generation);
+    }
+
+    //! \brief Cancels a timer.
+    //!
+    //! Cancels the timer referred to by the \p handle. Returns \p true, if
+    //! the timer has been armed.
+    bool cancel(const TimerHandle& handle) noexcept
+    {
+        if (handle.m_index >= m_nodes.size())
+            return false;
+        Node& node = m_nodes[handle.m_index];
+        if (!node.armed || node.generation != handle.m_generation)
+            return false;
+
+        unlink(handle.m_index);
+        release(handle.m_index);
+        return true;
+    }
+
+    //! \brief Returns the next tick with pending work.
+    //!
+    //! Returns the next tick at which a timer expires or at which timers
+    //! have to be cascaded. No timer expires before this tick. The wheel
+    //! must not be empty.
+    tick_type nextTick() const noexcept
+    {
+        for (unsigned level = 0; level < num_levels; ++level)
+        {
+            unsigned shift = level_bits * level;
+            unsigned current = unsigned(m_now >> shift) & slot_mask;
+            unsigned slot = findOccupiedSlot(level, current + 1);
+            if (slot < num_slots)
+            {
+                return ((m_now >> (shift + level_bits)) << (shift + level_bits))
+                       + (tick_type(slot) << shift);
+            }
+        }
+
+        // Only the overflow list is left.
+        unsigned shift = level_bits * num_levels;
+        return ((m_now >> shift) + 1) << shift;
+    }
+
+    //! \brief Advances the wheel.
+    //!
+    //! Advances the current tick to \p target and calls \p expire with the
+    //! payload of every timer, which expires up to this tick.
+    template <typename TFunction>
+    void advance(tick_type target, TFunction&& expire)
+    {
+        while (m_now < target)
+        {
+            if (m_size == 0)
+            {
+                m_now = target;
+                break;
+            }
+
+            tick_type next = nextTick();
+            if (next > target)
+            {
+                m_now = target;
+                break;
+            }
+            m_now = next;
+
+            // Cascade from the highest level down, such that the timers
+            // end up in the lowest possible level.
+            if ((m_now & ((tick_type(1) << (level_bits * num_levels)) - 1)) == 0)
+                cascade(overflow_slot);
+            for (unsigned level = num_levels - 1; level > 0; --level)
+            {
+                unsigned shift = level_bits * level;
+                if ((m_now & ((tick_type(1) << shift) - 1)) == 0)
+                {
+                    cascade(level * num_slots
+                            + (unsigned(m_now >> shift) & slot_mask));
+                }
+            }
+
+            unsigned slot = unsigned(m_now) & slot_mask;
+            while (m_heads[slot] != npos)
+            {
+                std::uint32_t idx = m_heads[slot];
+                unlink(idx);
+                TPayload payload = std::move(m_nodes[idx].payload);
+                release(idx);
+                expire(std::move(payload));
+            }
+        }
+    }
+
+private:
+    static constexpr unsigned num_levels = 4;
+    static constexpr unsigned level_bits = 8;
+    static constexpr unsigned num_slots = 1u << level_bits;
+    static constexpr unsigned slot_mask = num_slots - 1;
+    static constexpr unsigned overflow_slot = num_levels * num_slots;
+    static constexpr std::uint32_t npos = std::uint32_t(-1);
+
+    struct Node
+    {
+        tick_type expiry;
+        std::uint32_t prev;
+        //! The next node in the slot or in the free list.
+        std::uint32_t next;
+        std::uint32_t slot;
+        //! Incremented whenever the node is released, which invalidates
+        //! the handles to it.
+        std::uint32_t generation;
+        bool armed;
+        TPayload payload;
+    };
+
+    //! The current tick.
+    tick_type m_now;
+    //! The number of armed timers.
+    std::size_t m_size;
+    //! The pool of timers.
+    std::vector<Node> m_nodes;
+    //! The first unused node in the pool.
+    std::uint32_t m_freeList;
+    //! The first and the last timer of every slot and of the overflow list.
+    std::uint32_t m_heads[num_levels * num_slots + 1];
+    std::uint32_t m_tails[num_levels * num_slots + 1];
+    //! A bit for every slot, which is set if the slot is not empty.
+    std::uint64_t m_occupied[num_levels * num_slots / 64];
+
+    //! Returns the slot of a timer expiring at \p expiry.
+    unsigned slotFor(tick_type expiry) const noexcept
+    {
+        for (unsigned level = 0; level < num_levels; ++level)
+        {
+            unsigned shift = level_bits * (level + 1);
+            if ((expiry >> shift) == (m_now >> shift))
+            {
+                return level * num_slots
+                       + (unsigned(expiry >> (level_bits * level)) & slot_mask);
+            }
+        }
+        return overflow_slot;
+    }
+
+    //! Appends the node \p idx to the slot of its expiry tick.
+    void link(std::uint32_t idx) noexcept
+    {
+        Node& node = m_nodes[idx];
+        unsigned slot = slotFor(node.expiry);
+        node.slot = slot;
+        node.prev = m_tails[slot];
+        node.next = npos;
+        if (m_tails[slot] != npos)
+            m_nodes[m_tails[slot]].next = idx;
+        else
+            m_heads[slot] = idx;
+        m_tails[slot] = idx;
+        if (slot != overflow_slot)
+            m_occupied[slot / 64] |= std::uint64_t(1) << (slot % 64);
+    }
+
+    //! Removes the node \p idx from its slot.
+    void unlink(std::uint32_t idx) noexcept
+    {
+        Node& node = m_nodes[idx];
+        unsigned slot = node.slot;
+        if (node.prev != npos)
+            m_nodes[node.prev].next = node.next;
+        else
+            m_heads[slot] = node.next;
+        if (node.next != npos)
+            m_nodes[node.next].prev = node.prev;
+        else
+            m_tails[slot] = node.prev;
+        if (m_heads[slot] == npos && slot != overflow_slot)
+            m_occupied[slot / 64] &= ~(std::uint64_t(1) << (slot % 64));
+    }
+
+    //! Puts the unlinked node \p idx back into the free list.
+    void release(std::uint32_t idx) noexcept
+    {
+        Node& node = m_nodes[idx];
+        node.payload = TPayload();
+        node.armed = false;
+        ++node.generation;
+        node.next = m_freeList;
+        m_freeList = idx;
+        --m_size;
+    }
+
+    //! Re-inserts all timers of the \p slot relative to the current tick.
+    void cascade(unsigned slot) noexcept
+    {
+        std::uint32_t idx = m_heads[slot];
+        m_heads[slot] = npos;
+        m_tails[slot] = npos;
+        if (slot != overflow_slot)
+            m_occupied[slot / 64] &= ~(std::uint64_t(1) << (slot % 64));
+
+        while (idx != npos)
+        {
+            std::uint32_t next = m_nodes[idx].next;
+            link(idx);
+            idx = next;
+        }
+    }
+
+    //! Returns the first occupied slot of the \p level, which is not less
+    //! than \p first. If there is no such slot, num_slots is returned.
+    unsigned findOccupiedSlot(unsigned level, unsigned first) const noexcept
+    {
+        const unsigned words_per_level = num_slots / 64;
+        for (unsigned word = first / 64; word < words_per_level; ++word)
+        {
+            std::uint64_t bits = m_occupied[level * words_per_level + word];
+            if (word == first / 64)
+                bits &= ~std::uint64_t(0) << (first % 64);
+            if (bits)
+                return word * 64 + countTrailingZeros(bits);
+        }
+        return num_slots;
+    }
+
+    static unsigned countTrailingZeros(std::uint64_t bits) noexcept
+    {
+#if defined(__GNUC__)
+        return unsigned(__builtin_ctzll(bits));
+#else
+        unsigned count = 0;
+        while (!(bits & 1))
+        {
+            bits >>= 1;
+            ++count;
+        }
+        return count;
+#endif
+    }
+};
+
+template <typename TPayload>
+constexpr unsigned TimerWheel<TPayload>::num_levels;
+
+template <typename TPayload>
+constexpr unsigned TimerWheel<TPayload>::level_bits;
+
+template <typename TPayload>
+constexpr unsigned TimerWheel<TPayload>::num_slots;
+
+template <typename TPayload>
+constexpr unsigned TimerWheel<TPayload>::slot_mask;
+
+template <typename TPayload>
+constexpr unsigned TimerWheel<TPayload>::overflow_slot;
+
+template <typename TPayload>
+constexpr std::uint32_t TimerWheel<TPayload>::npos;
+
+} // namespace fsm11_detail
+} // namespace fsm11
+
+#endif // FSM11_DETAIL_TIMERWHEEL_HPP
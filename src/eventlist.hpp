@@ -0,0 +1,476 @@
+/*******************************************************************************
+  fsm11 - A C++ library for finite state machines
+
+  Copyright (c) 2015-2016, Manuel Freiberger
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  - Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+  - Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#ifndef FSM11_EVENTLIST_HPP
+#define FSM11_EVENTLIST_HPP
+
+#ifdef FSM11_USE_WEOS
+#include <weos/atomic.hpp>
+#include <weos/type_traits.hpp>
+#include <weos/utility.hpp>
+#else
+#include <atomic>
+#include <type_traits>
+#include <utility>
+#endif // FSM11_USE_WEOS
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace fsm11
+{
+
+// ----=====================================================================----
+//     LockFreeEventQueue
+// ----=====================================================================----
+
+//! \brief A lock-free multi-producer single-consumer event queue.
+//!
+//! The LockFreeEventQueue is a bounded queue with space for \p TCapacity
+//! events, which can be used as event list of a state machine with
+//! asynchronous event dispatching:
+//! \code
+//! using StateMachine_t = StateMachine<
+//!                            AsynchronousEventDispatching,
+//!                            EventListType<LockFreeEventQueue<int, 1024>>>;
+//! \endcode
+//! Any number of threads can add events concurrently without taking a lock.
+//! The event loop consumes them without a lock, too, and only parks on a
+//! condition variable when the queue is empty. Producers only touch the
+//! mutex of the event loop if the event loop is asleep.
+//!
+//! When the queue is full, the new event is rejected and addEvent() returns
+//! \p false. The producer is never blocked, so an action of the state
+//! machine can add events without deadlocking the event loop. A producer,
+//! which must not lose an event, has to retry later.
+//!
+//! The queue is based on Dmitry Vyukov's bounded MPMC queue. Every cell
+//! has a sequence number, which tells whether the cell is free or holds an
+//! event ready for consumption.
+template <typename TType, std::size_t TCapacity>
+class LockFreeEventQueue
+{
+    static_assert(TCapacity >= 2 && (TCapacity & (TCapacity - 1)) == 0,
+                  "The capacity must be a power of two.");
+    static_assert(std::is_nothrow_move_constructible<TType>::value,
+                  "The events must be nothrow move-constructible.");
+
+public:
+    using value_type = TType;
+
+    //! Tells the event dispatcher that push_back() can be called without
+    //! holding a lock.
+    static constexpr bool lock_free_push = true;
+
+    LockFreeEventQueue() noexcept
+        : m_enqueuePosition(0),
+          m_dequeuePosition(0)
+    {
+        for (std::size_t idx = 0; idx < TCapacity; ++idx)
+            m_cells[idx].sequence.store(idx, std::memory_order_relaxed);
+    }
+
+    LockFreeEventQueue(const LockFreeEventQueue&) = delete;
+    LockFreeEventQueue& operator=(const LockFreeEventQueue&) = delete;
+
+    ~LockFreeEventQueue()
+    {
+        while (!empty())
+            pop_front();
+    }
+
+    //! Returns the maximum number of events in the queue.
+    static constexpr std::size_t capacity() noexcept
+    {
+        return TCapacity;
+    }
+
+    //! \brief Checks if the queue is empty.
+    //!
+    //! Returns \p true, if the queue has no event ready for consumption.
+    //! Must only be called by the consumer.
+    bool empty() const noexcept
+    {
+        const Cell& cell = m_cells[m_dequeuePosition & (TCapacity - 1)];
+        return cell.sequence.load(std::memory_order_acquire)
+               != m_dequeuePosition + 1;
+    }
+
+    //! \brief Returns the oldest event.
+    //!
+    //! Must only be called by the consumer and only if the queue is not
+    //! empty.
+    TType& front() noexcept
+    {
+        return *m_cells[m_dequeuePosition & (TCapacity - 1)].value();
+    }
+
+    //! \brief Removes the oldest event.
+    //!
+    //! Must only be called by the consumer and only if the queue is not
+    //! empty.
+    void pop_front() noexcept
+    {
+        Cell& cell = m_cells[m_dequeuePosition & (TCapacity - 1)];
+        cell.value()->~TType();
+        cell.sequence.store(m_dequeuePosition + TCapacity,
+                            std::memory_order_release);
+        ++m_dequeuePosition;
+    }
+
+    //! \brief Appends an event.
+    //!
+    //! Appends the \p event to the queue and returns \p true. If the queue
+    //! is full, the \p event is discarded and \p false is returned. This
+    //! function can be called from multiple threads concurrently.
+    bool push_back(TType event) noexcept
+    {
+        return tryPush(event);
+    }
+
+    //! \brief Tries to append an event.
+    //!
+    //! Appends the \p event to the queue and returns \p true. If the queue
+    //! is full, the \p event is left untouched and \p false is returned.
+    bool tryPush(TType& event) noexcept
+    {
+        std::size_t position
+                = m_enqueuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = m_cells[position & (TCapacity - 1)];
+            std::size_t sequence
+                    = cell.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = std::ptrdiff_t(sequence)
+                                        - std::ptrdiff_t(position);
+            if (difference == 0)
+            {
+                // The cell is free. Try to claim it.
+                if (m_enqueuePosition.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed))
+                {
+                    ::new (&cell.storage) TType(std::move(event));
+                    cell.sequence.store(position + 1,
+                                        std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                // The cell still holds an event from the previous round.
+                return false;
+            }
+            else
+            {
+                // Another producer has claimed the cell.
+                position = m_enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        typename std::aligned_storage<sizeof(TType),
+                                      std::alignment_of<TType>::value>::type
+            storage;
+
+        TType* value() noexcept
+        {
+            return static_cast<TType*>(static_cast<void*>(&storage));
+        }
+    };
+
+    Cell m_cells[TCapacity];
+    //! The position of the next event to be enqueued. Shared by the
+    //! producers.
+    std::atomic<std::size_t> m_enqueuePosition;
+    //! Keeps the producer and the consumer positions in different cache
+    //! lines.
+    char m_padding[64];
+    //! The position of the next event to be dequeued. Owned by the
+    //! consumer.
+    std::size_t m_dequeuePosition;
+};
+
+template <typename TType, std::size_t TCapacity>
+constexpr bool LockFreeEventQueue<TType, TCapacity>::lock_free_push;
+
+// ----=====================================================================----
+//     RingBufferEventList
+// ----=====================================================================----
+
+//! Defines what happens if an event is added to a full RingBufferEventList.
+enum class EventOverflowPolicy : std::uint8_t
+{
+    //! The producer is blocked until the event loop has made room. This
+    //! requires asynchronous event dispatching. With synchronous event
+    //! dispatching and in the actions, which are run by the event loop,
+    //! the new event is rejected like with FailProducer. Blocking there
+    //! would deadlock the state machine.
+    BlockProducer,
+    //! The new event is rejected and addEvent() returns \p false.
+    FailProducer,
+    //! The new event is discarded silently. addEvent() returns \p true and
+    //! the loss only shows up in the statistics.
+    DropNewest,
+    //! The oldest pending event is discarded to make room for the new one.
+    DropOldest,
+    //! If an equal event is still pending, the new event is merged into it.
+    //! Otherwise, the new event is rejected.
+    Coalesce
+};
+
+//! \brief Statistics of a bounded event list.
+struct EventListStatistics
+{
+    //! The maximum number of events, which have been in the list at the
+    //! same time.
+    std::size_t highWaterMark;
+    //! The number of events, which have been added to a full list.
+    std::size_t numOverflows;
+    //! The number of events, which have been rejected, dropped or merged
+    //! due to an overflow.
+    std::size_t numDropped;
+};
+
+//! \brief A fixed-capacity event list.
+//!
+//! The RingBufferEventList stores up to \p TCapacity events in-place. It
+//! never allocates memory, which makes the memory consumption and the
+//! latency of a state machine predictable when it is overloaded. The
+//! \p TPolicy determines how an overflow is handled. The list is used via
+//! the EventListType<> option:
+//! \code
+//! using StateMachine_t = StateMachine<
+//!                            AsynchronousEventDispatching,
+//!                            EventListType<RingBufferEventList<
+//!                                int, 64, EventOverflowPolicy::DropOldest>>>;
+//! \endcode
+//!
+//! The ring buffer is not thread-safe. The event dispatcher guards it by
+//! the same lock as any other event list: the state machine's lock with
+//! synchronous dispatching, the mutex of the event loop with asynchronous
+//! dispatching and the task mutex with executor dispatching. Only its
+//! statistics() may be queried concurrently.
+template <typename TType, std::size_t TCapacity,
+          EventOverflowPolicy TPolicy = EventOverflowPolicy::BlockProducer>
+class RingBufferEventList
+{
+    static_assert(TCapacity > 0, "The capacity must not be zero.");
+
+public:
+    using value_type = TType;
+
+    //! The policy, which is applied when adding an event to a full list.
+    static constexpr EventOverflowPolicy overflow_policy = TPolicy;
+    //! Tells the event dispatcher to wait for room in the list before
+    //! adding an event.
+    static constexpr bool block_when_full
+            = TPolicy == EventOverflowPolicy::BlockProducer;
+
+    RingBufferEventList() noexcept
+        : m_head(0),
+          m_size(0),
+          m_highWaterMark(0),
+          m_numOverflows(0),
+          m_numDropped(0)
+    {
+    }
+
+    RingBufferEventList(const RingBufferEventList&) = delete;
+    RingBufferEventList& operator=(const RingBufferEventList&) = delete;
+
+    ~RingBufferEventList()
+    {
+        while (!empty())
+            pop_front();
+    }
+
+    //! Returns the maximum number of events in the list.
+    static constexpr std::size_t capacity() noexcept
+    {
+        return TCapacity;
+    }
+
+    //! Returns the number of events in the list.
+    std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    //! Returns \p true, if the list contains no event.
+    bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    //! Returns \p true, if the list cannot take another event.
+    bool full() const noexcept
+    {
+        return m_size == TCapacity;
+    }
+
+    //! \brief Returns the oldest event.
+    //!
+    //! The list must not be empty.
+    TType& front() noexcept
+    {
+        return *slot(m_head);
+    }
+
+    //! \brief Removes the oldest event.
+    //!
+    //! The list must not be empty.
+    void pop_front() noexcept
+    {
+        slot(m_head)->~TType();
+        m_head = m_head + 1 == TCapacity ? 0 : m_head + 1;
+        --m_size;
+    }
+
+    //! \brief Appends an event.
+    //!
+    //! Appends the \p event to the list. If the list is full, the overflow
+    //! policy is applied. Returns \p true, if the \p event has been stored
+    //! or merged into a pending event.
+    bool push_back(TType event)
+    {
+        if (full())
+        {
+            m_numOverflows.store(m_numOverflows.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_relaxed);
+            m_numDropped.store(m_numDropped.load(std::memory_order_relaxed) + 1,
+                               std::memory_order_relaxed);
+            if (!handleOverflow(event,
+                                std::integral_constant<EventOverflowPolicy, TPolicy>()))
+            {
+                return false;
+            }
+            // A coalesced or dropped event does not need a slot of its own.
+            if (full())
+                return true;
+        }
+
+        std::size_t tail = m_head + m_size;
+        if (tail >= TCapacity)
+            tail -= TCapacity;
+        ::new (static_cast<void*>(slot(tail))) TType(std::move(event));
+        ++m_size;
+
+        if (m_size > m_highWaterMark.load(std::memory_order_relaxed))
+            m_highWaterMark.store(m_size, std::memory_order_relaxed);
+        return true;
+    }
+
+    //! \brief Returns the statistics.
+    //!
+    //! This function may be called concurrently to the other functions.
+    EventListStatistics statistics() const noexcept
+    {
+        return EventListStatistics{
+                    m_highWaterMark.load(std::memory_order_relaxed),
+                    m_numOverflows.load(std::memory_order_relaxed),
+                    m_numDropped.load(std::memory_order_relaxed)};
+    }
+
+private:
+    using storage_type = typename std::aligned_storage<
+                             sizeof(TType),
+                             std::alignment_of<TType>::value>::type;
+
+    storage_type m_events[TCapacity];
+    std::size_t m_head;
+    std::size_t m_size;
+
+    // The statistics are written with the lock of the list held but they
+    // can be read at any time.
+    std::atomic<std::size_t> m_highWaterMark;
+    std::atomic<std::size_t> m_numOverflows;
+    std::atomic<std::size_t> m_numDropped;
+
+    TType* slot(std::size_t index) noexcept
+    {
+        return static_cast<TType*>(static_cast<void*>(&m_events[index]));
+    }
+
+    //! Handles an overflow. Returns \p true, if the \p event has been
+    //! accepted. In this case, the event still has to be stored if the
+    //! list is not full anymore.
+    template <EventOverflowPolicy TOtherPolicy>
+    bool handleOverflow(
+            TType&, std::integral_constant<EventOverflowPolicy, TOtherPolicy>)
+    {
+        return false;
+    }
+
+    bool handleOverflow(
+            TType&,
+            std::integral_constant<EventOverflowPolicy,
+                                   EventOverflowPolicy::DropNewest>)
+    {
+        return true;
+    }
+
+    bool handleOverflow(
+            TType&,
+            std::integral_constant<EventOverflowPolicy,
+                                   EventOverflowPolicy::DropOldest>)
+    {
+        pop_front();
+        return true;
+    }
+
+    bool handleOverflow(
+            TType& event,
+            std::integral_constant<EventOverflowPolicy,
+                                   EventOverflowPolicy::Coalesce>)
+    {
+        std::size_t index = m_head;
+        for (std::size_t count = 0; count < m_size; ++count)
+        {
+            if (*slot(index) == event)
+                return true;
+            index = index + 1 == TCapacity ? 0 : index + 1;
+        }
+        return false;
+    }
+};
+
+template <typename TType, std::size_t TCapacity, EventOverflowPolicy TPolicy>
+constexpr EventOverflowPolicy
+RingBufferEventList<TType, TCapacity, TPolicy>::overflow_policy;
+
+template <typename TType, std::size_t TCapacity, EventOverflowPolicy TPolicy>
+constexpr bool RingBufferEventList<TType, TCapacity, TPolicy>::block_when_full;
+
+} // namespace fsm11
+
+#endif // FSM11_EVENTLIST_HPP
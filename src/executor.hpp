@@ -0,0 +1,259 @@
+/*******************************************************************************
+  fsm11 - A C++ library for finite state machines
+
+  Copyright (c) 2015-2016, Manuel Freiberger
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  - Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+  - Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#ifndef FSM11_EXECUTOR_HPP
+#define FSM11_EXECUTOR_HPP
+
+#include "statemachine_fwd.hpp"
+
+#ifdef FSM11_USE_WEOS
+#include <weos/atomic.hpp>
+#include <weos/condition_variable.hpp>
+#include <weos/mutex.hpp>
+#include <weos/thread.hpp>
+#else
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif // FSM11_USE_WEOS
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace fsm11
+{
+
+//! \brief A unit of work, which is run by an Executor.
+//!
+//! A task is scheduled by handing it to Executor::schedule(). The executor
+//! calls execute() exactly once per scheduling, unless the task is
+//! cancelled or the executor is destroyed before. A task must not be
+//! scheduled again before execute() has been called.
+class ExecutorTask
+{
+public:
+    virtual
+    ~ExecutorTask() {}
+
+    //! Runs a time slice of the task.
+    virtual
+    void execute() = 0;
+
+    //! Called instead of execute(), if the executor is destroyed while the
+    //! task is scheduled. The executor must not be accessed any more.
+    virtual
+    void discard() noexcept {}
+
+private:
+    //! The next task in an intrusive queue of an executor.
+    ExecutorTask* m_nextTask{nullptr};
+
+    friend class ReactorExecutor;
+    friend class WorkStealingExecutor;
+};
+
+//! \brief An executor for state machines.
+//!
+//! An executor runs the state machines, which have been created with the
+//! option ExecutorEventDispatching, on a set of threads, which is
+//! independent of the number of state machines. A state machine schedules
+//! itself when it has a pending event or a start or stop request. It
+//! dispatches a batch of events (see EventLoopBatchSize) and schedules
+//! itself again, if more events are pending. A state machine is never
+//! run by two threads at the same time.
+class Executor
+{
+public:
+    virtual
+    ~Executor() {}
+
+    //! Schedules the \p task for execution.
+    virtual
+    void schedule(ExecutorTask* task) = 0;
+
+    //! \brief Cancels a scheduled task.
+    //!
+    //! Removes the \p task from the executor's queues. Returns \p true, if
+    //! the task has been removed, in which case execute() will not be
+    //! called. Returns \p false, if the task is not queued, e.g. because
+    //! it has already been taken by a thread, which is about to execute it.
+    virtual
+    bool cancel(ExecutorTask* task) = 0;
+};
+
+//! \brief A reactor.
+//!
+//! The reactor keeps a ready-queue of the scheduled tasks and executes
+//! them in FIFO order. As a state machine re-schedules itself after a
+//! batch of events, the state machines are served round-robin. The reactor
+//! is driven by calling run() or poll() from one or more threads.
+class ReactorExecutor : public Executor
+{
+public:
+    ReactorExecutor();
+
+    ReactorExecutor(const ReactorExecutor&) = delete;
+    ReactorExecutor& operator=(const ReactorExecutor&) = delete;
+
+    //! \brief Destroys the reactor.
+    //!
+    //! The tasks, which are still in the ready-queue, are discarded. No
+    //! thread must be in run() or poll().
+    virtual
+    ~ReactorExecutor();
+
+    virtual
+    void schedule(ExecutorTask* task) override;
+
+    virtual
+    bool cancel(ExecutorTask* task) override;
+
+    //! \brief Runs the reactor.
+    //!
+    //! Executes the scheduled tasks in the calling thread and waits for
+    //! new ones, if the ready-queue is empty. The function returns after
+    //! exit() has been called. If a task throws an exception, it is
+    //! propagated to the caller. The reactor can be resumed by calling
+    //! run() again.
+    void run();
+
+    //! \brief Executes the ready tasks.
+    //!
+    //! Executes the scheduled tasks in the calling thread until the
+    //! ready-queue is empty and returns the number of executed tasks. This
+    //! function does not block and can be used to integrate the reactor
+    //! into an existing main loop.
+    std::size_t poll();
+
+    //! \brief Exits the reactor.
+    //!
+    //! Makes all threads return from run() after they have finished their
+    //! current task. Later calls to run() return immediately. The tasks,
+    //! which have not been executed, remain in the ready-queue until they
+    //! are cancelled or the reactor is destroyed.
+    void exit();
+
+private:
+    std::mutex m_mutex;
+    //! This CV signals that a task has been scheduled or that the reactor
+    //! has to exit.
+    std::condition_variable m_cv;
+    //! The head and the tail of the ready-queue.
+    ExecutorTask* m_head;
+    ExecutorTask* m_tail;
+    //! Set if leaving run() has been requested.
+    bool m_exitRequest;
+
+    //! Removes the first task from the ready-queue. The caller has to hold
+    //! the mutex.
+    ExecutorTask* pop() noexcept;
+};
+
+//! \brief A work-stealing executor.
+//!
+//! The executor owns a set of worker threads. Every worker has its own
+//! deque of tasks. A task, which is scheduled from a worker, is appended
+//! to the worker's deque. A task, which is scheduled from another thread,
+//! is distributed round-robin. A worker takes its tasks from the front of
+//! its deque. When its deque is empty, it steals a task from the back of
+//! another worker's deque before it goes to sleep. So a few busy state
+//! machines do not keep the other workers idle.
+//!
+//! An exception, which is thrown by a task, terminates the program.
+class WorkStealingExecutor : public Executor
+{
+public:
+    //! Creates an executor with \p numWorkers worker threads. By default,
+    //! one worker per hardware thread is created.
+    explicit
+    WorkStealingExecutor(unsigned numWorkers = std::thread::hardware_concurrency());
+
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+    //! \brief Destroys the executor.
+    //!
+    //! Waits until the workers have finished their current task and joins
+    //! them. The tasks, which have not been executed, are discarded.
+    virtual
+    ~WorkStealingExecutor();
+
+    virtual
+    void schedule(ExecutorTask* task) override;
+
+    virtual
+    bool cancel(ExecutorTask* task) override;
+
+    //! Returns the number of worker threads.
+    std::size_t numWorkers() const noexcept
+    {
+        return m_workers.size();
+    }
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<ExecutorTask*> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    //! The number of tasks in all deques. It is incremented before a task
+    //! is pushed and decremented after a task has been popped.
+    std::atomic<std::size_t> m_numTasks;
+    //! The number of workers, which are (about to be) asleep.
+    std::atomic<unsigned> m_numSleepers;
+    //! The index of the next worker, which receives a task from a thread
+    //! outside of the executor.
+    std::atomic<unsigned> m_nextWorker;
+    //! Guards the sleeping of the workers.
+    std::mutex m_sleepMutex;
+    //! This CV signals that a task has been scheduled or that the workers
+    //! have to exit.
+    std::condition_variable m_sleepCv;
+    //! Set when the executor is destroyed.
+    std::atomic<bool> m_exitRequest;
+
+    //! Makes the workers exit and joins them.
+    void joinWorkers();
+
+    void work(std::size_t index);
+
+    //! Takes a task from the front of the deque of the worker \p index or
+    //! steals one from another worker. Returns a null-pointer, if all
+    //! deques are empty.
+    ExecutorTask* take(std::size_t index);
+};
+
+} // namespace fsm11
+
+#endif // FSM11_EXECUTOR_HPP
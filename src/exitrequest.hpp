@@ -32,23 +32,69 @@
 #include "statemachine_fwd.hpp"
 
 #ifdef FSM11_USE_WEOS
+#include <weos/atomic.hpp>
 #include <weos/chrono.hpp>
-#include <weos/condition_variable.hpp>
+#include <weos/functional.hpp>
 #include <weos/mutex.hpp>
+#include <weos/thread.hpp>
+#include <weos/type_traits.hpp>
+#include <weos/utility.hpp>
 #else
+#include <atomic>
 #include <chrono>
-#include <condition_variable>
+#include <functional>
 #include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #endif // FSM11_USE_WEOS
 
+#include <cstdint>
+
 namespace fsm11
 {
+class ExitRequest;
+
+namespace fsm11_detail
+{
+
+//! The part of an ExitCallback, which does not depend on the type of the
+//! callback.
+class ExitCallbackBase
+{
+protected:
+    ExitCallbackBase() noexcept
+        : m_done(0)
+    {
+    }
+
+    ExitCallbackBase(const ExitCallbackBase&) = delete;
+    ExitCallbackBase& operator=(const ExitCallbackBase&) = delete;
+
+    virtual
+    void execute() noexcept = 0;
+
+private:
+    ExitCallbackBase* m_next = nullptr;
+    //! Set to 1, when the callback has been executed by an exit request.
+    std::atomic<std::uint32_t> m_done;
 
+    friend class fsm11::ExitRequest;
+};
+
+} // namespace fsm11_detail
+
+//! \brief A request to exit an invoke action.
+//!
+//! The request is set when the state of the invoke action is left. Polling
+//! the request is a single atomic load. A thread waiting for the request
+//! sleeps on a futex. An invoke action, which blocks in a call that
+//! cannot poll, can register an ExitCallback to cancel the call.
 class ExitRequest
 {
 public:
-    ExitRequest()
-        : m_requested(false)
+    ExitRequest() noexcept
+        : m_state(0)
     {
     }
 
@@ -56,36 +102,68 @@ public:
     ExitRequest& operator=(const ExitRequest&) = delete;
 
     //! Waits for an exit request.
-    void wait()
-    {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_cv.wait(lock, [&] { return m_requested; });
-    }
+    void wait();
 
     //! Waits for an exit request with a timeout.
     //!
     //! Waits for an exit request or until the \p timeout is expired.
+    //! Returns \p true if an exit has been requested.
     template <typename TRep, typename TPeriod>
     bool waitFor(const std::chrono::duration<TRep, TPeriod>& timeout)
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        return m_cv.wait_for(lock, timeout, [&] { return m_requested; });
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout);
+        if (ns < timeout)
+            ++ns;
+        return doWaitFor(ns);
     }
 
     //! Checks if an exit has been requested.
     //!
     //! Returns \p true if an exit has been requested.
     explicit
-    operator bool() const
+    operator bool() const noexcept
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_requested;
+        return (m_state.load(std::memory_order_acquire) & Requested) != 0;
     }
 
 private:
-    mutable std::mutex m_mutex;
-    std::condition_variable m_cv;
-    bool m_requested;
+    enum : std::uint32_t
+    {
+        Requested = 1,
+        //! Set when a thread sleeps on the futex.
+        Waiting = 2
+    };
+
+    std::atomic<std::uint32_t> m_state;
+
+    //! Protects the list of callbacks. It is not needed for polling.
+    std::mutex m_callbackMutex;
+    fsm11_detail::ExitCallbackBase* m_callbacks = nullptr;
+    //! The callback, which is being executed, and the executing thread.
+    fsm11_detail::ExitCallbackBase* m_executingCallback = nullptr;
+    std::thread::id m_executingThread;
+
+
+    bool doWaitFor(std::chrono::nanoseconds timeout);
+
+    //! Clears the request. Must not be called while callbacks are
+    //! registered.
+    void reset() noexcept
+    {
+        m_state.store(0, std::memory_order_relaxed);
+    }
+
+    //! Sets the request, wakes the waiting threads and executes the
+    //! registered callbacks.
+    void request();
+
+    //! Registers the \p callback. Returns \p false, if an exit has been
+    //! requested already. In this case, the callback is not registered.
+    bool addCallback(fsm11_detail::ExitCallbackBase* callback);
+
+    //! Unregisters the \p callback. If another thread executes the
+    //! callback, waits until it has finished.
+    void removeCallback(fsm11_detail::ExitCallbackBase* callback);
 
 
     template <typename TStateMachine>
@@ -93,6 +171,61 @@ private:
 
     template <typename TStateMachine>
     friend class ThreadedFunctionState;
+
+    template <typename TCallback>
+    friend class ExitCallback;
+};
+
+//! \brief A callback, which is executed upon an exit request.
+//!
+//! The callback is registered with an ExitRequest during the lifetime of
+//! this object. It is executed in the thread, which requests the exit. If
+//! the exit has been requested already, the callback is executed in the
+//! constructor. The destructor waits until a callback, which is being
+//! executed in another thread, has finished. The callback must not throw.
+//!
+//! \code
+//! void invoke(ExitRequest& exitRequest) override
+//! {
+//!     ExitCallback<> cancelRead(exitRequest, [&] { m_socket.shutdown(); });
+//!     m_socket.read(m_buffer);
+//! }
+//! \endcode
+template <typename TCallback = std::function<void()>>
+class ExitCallback : private fsm11_detail::ExitCallbackBase
+{
+public:
+    //! Registers the callback \p cb with the \p exitRequest.
+    template <typename T>
+    ExitCallback(ExitRequest& exitRequest, T&& cb)
+        : m_exitRequest(exitRequest),
+          m_callback(std::forward<T>(cb))
+    {
+        m_registered = m_exitRequest.addCallback(this);
+        if (!m_registered)
+            m_callback();
+    }
+
+    ExitCallback(const ExitCallback&) = delete;
+    ExitCallback& operator=(const ExitCallback&) = delete;
+
+    //! Unregisters the callback.
+    ~ExitCallback()
+    {
+        if (m_registered)
+            m_exitRequest.removeCallback(this);
+    }
+
+private:
+    ExitRequest& m_exitRequest;
+    TCallback m_callback;
+    bool m_registered;
+
+    virtual
+    void execute() noexcept override
+    {
+        m_callback();
+    }
 };
 
 } // namespace fsm11
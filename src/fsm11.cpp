@@ -27,13 +27,34 @@
 *******************************************************************************/
 
 #include "error.hpp"
+#include "executor.hpp"
+#include "exitrequest.hpp"
+#include "detail/futex.hpp"
 
 #ifdef FSM11_USE_WEOS
+#include <weos/chrono.hpp>
+#include <weos/condition_variable.hpp>
+#include <weos/mutex.hpp>
+#include <weos/thread.hpp>
 #include <weos/utility.hpp>
 #else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <utility>
 #endif // FSM11_USE_WEOS
 
+#include <algorithm>
+#include <climits>
+
+#if defined(__linux__) && !defined(FSM11_USE_WEOS)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define FSM11_HAS_FUTEX
+#endif
+
 using namespace std;
 
 namespace fsm11
@@ -73,4 +94,454 @@ const error_category& fsm11_category() noexcept
     return categoryInstance;
 }
 
+// ----=====================================================================----
+//     ReactorExecutor
+// ----=====================================================================----
+
+ReactorExecutor::ReactorExecutor()
+    : m_head(nullptr),
+      m_tail(nullptr),
+      m_exitRequest(false)
+{
+}
+
+ReactorExecutor::~ReactorExecutor()
+{
+    ExecutorTask* task = m_head;
+    m_head = m_tail = nullptr;
+    while (task)
+    {
+        // The task may be re-used as soon as it has been discarded.
+        ExecutorTask* next = task->m_nextTask;
+        task->discard();
+        task = next;
+    }
+}
+
+void ReactorExecutor::schedule(ExecutorTask* task)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        task->m_nextTask = nullptr;
+        if (m_tail)
+            m_tail->m_nextTask = task;
+        else
+            m_head = task;
+        m_tail = task;
+    }
+    m_cv.notify_one();
+}
+
+bool ReactorExecutor::cancel(ExecutorTask* task)
+{
+    lock_guard<mutex> lock(m_mutex);
+    ExecutorTask* prev = nullptr;
+    for (ExecutorTask* iter = m_head; iter; prev = iter, iter = iter->m_nextTask)
+    {
+        if (iter != task)
+            continue;
+
+        if (prev)
+            prev->m_nextTask = task->m_nextTask;
+        else
+            m_head = task->m_nextTask;
+        if (m_tail == task)
+            m_tail = prev;
+        return true;
+    }
+    return false;
+}
+
+void ReactorExecutor::run()
+{
+    while (true)
+    {
+        ExecutorTask* task;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_head || m_exitRequest; });
+            if (m_exitRequest)
+                return;
+            task = pop();
+        }
+        task->execute();
+    }
+}
+
+size_t ReactorExecutor::poll()
+{
+    size_t numExecuted = 0;
+    while (true)
+    {
+        ExecutorTask* task;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            if (!m_head || m_exitRequest)
+                return numExecuted;
+            task = pop();
+        }
+        task->execute();
+        ++numExecuted;
+    }
+}
+
+void ReactorExecutor::exit()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_exitRequest = true;
+    }
+    m_cv.notify_all();
+}
+
+ExecutorTask* ReactorExecutor::pop() noexcept
+{
+    ExecutorTask* task = m_head;
+    m_head = task->m_nextTask;
+    if (!m_head)
+        m_tail = nullptr;
+    return task;
+}
+
+// ----=====================================================================----
+//     WorkStealingExecutor
+// ----=====================================================================----
+
+namespace
+{
+//! The executor and the index of the worker, which runs in this thread.
+thread_local const WorkStealingExecutor* t_currentExecutor = nullptr;
+thread_local size_t t_currentWorker = 0;
+} // anonymous namespace
+
+WorkStealingExecutor::WorkStealingExecutor(unsigned numWorkers)
+    : m_numTasks(0),
+      m_numSleepers(0),
+      m_nextWorker(0),
+      m_exitRequest(false)
+{
+    if (numWorkers == 0)
+        numWorkers = 1;
+
+    m_workers.reserve(numWorkers);
+    for (unsigned idx = 0; idx < numWorkers; ++idx)
+        m_workers.emplace_back(new Worker);
+
+    try
+    {
+        for (unsigned idx = 0; idx < numWorkers; ++idx)
+            m_workers[idx]->thread = thread(&WorkStealingExecutor::work, this, idx);
+    }
+    catch (...)
+    {
+        joinWorkers();
+        throw;
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor()
+{
+    joinWorkers();
+
+    for (auto& worker : m_workers)
+        for (ExecutorTask* task : worker->tasks)
+            task->discard();
+}
+
+void WorkStealingExecutor::joinWorkers()
+{
+    {
+        lock_guard<mutex> lock(m_sleepMutex);
+        m_exitRequest = true;
+    }
+    m_sleepCv.notify_all();
+
+    for (auto& worker : m_workers)
+        if (worker->thread.joinable())
+            worker->thread.join();
+}
+
+void WorkStealingExecutor::schedule(ExecutorTask* task)
+{
+    size_t index = t_currentExecutor == this
+                   ? t_currentWorker
+                   : m_nextWorker++ % m_workers.size();
+
+    // The counter is incremented first, so that it never drops below the
+    // number of tasks in the deques.
+    ++m_numTasks;
+    {
+        Worker& worker = *m_workers[index];
+        lock_guard<mutex> lock(worker.mutex);
+        worker.tasks.push_back(task);
+    }
+
+    // Pairs with a sleeping worker: Either the worker sees the new task
+    // or this thread sees the sleeper and wakes it up.
+    if (m_numSleepers != 0)
+    {
+        m_sleepMutex.lock();
+        m_sleepMutex.unlock();
+        m_sleepCv.notify_one();
+    }
+}
+
+bool WorkStealingExecutor::cancel(ExecutorTask* task)
+{
+    for (auto& worker : m_workers)
+    {
+        lock_guard<mutex> lock(worker->mutex);
+        auto iter = find(worker->tasks.begin(), worker->tasks.end(), task);
+        if (iter != worker->tasks.end())
+        {
+            worker->tasks.erase(iter);
+            --m_numTasks;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingExecutor::work(size_t index)
+{
+    t_currentExecutor = this;
+    t_currentWorker = index;
+
+    while (!m_exitRequest)
+    {
+        if (ExecutorTask* task = take(index))
+        {
+            task->execute();
+            continue;
+        }
+
+        unique_lock<mutex> lock(m_sleepMutex);
+        ++m_numSleepers;
+        m_sleepCv.wait(lock, [this] {
+            return m_numTasks != 0 || m_exitRequest;
+        });
+        --m_numSleepers;
+    }
+}
+
+ExecutorTask* WorkStealingExecutor::take(size_t index)
+{
+    {
+        Worker& worker = *m_workers[index];
+        lock_guard<mutex> lock(worker.mutex);
+        if (!worker.tasks.empty())
+        {
+            ExecutorTask* task = worker.tasks.front();
+            worker.tasks.pop_front();
+            --m_numTasks;
+            return task;
+        }
+    }
+
+    for (size_t offset = 1; offset < m_workers.size(); ++offset)
+    {
+        Worker& victim = *m_workers[(index + offset) % m_workers.size()];
+        lock_guard<mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            ExecutorTask* task = victim.tasks.back();
+            victim.tasks.pop_back();
+            --m_numTasks;
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+// ----=====================================================================----
+//     Futex
+// ----=====================================================================----
+
+namespace fsm11_detail
+{
+
+#ifdef FSM11_HAS_FUTEX
+
+void futexWait(atomic<uint32_t>& word, uint32_t expected)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word),
+            FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+void futexWaitFor(atomic<uint32_t>& word, uint32_t expected,
+                  chrono::nanoseconds timeout)
+{
+    if (timeout <= chrono::nanoseconds::zero())
+        return;
+
+    auto secs = chrono::duration_cast<chrono::seconds>(timeout);
+    timespec ts;
+    ts.tv_sec = secs.count();
+    ts.tv_nsec = (timeout - secs).count();
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word),
+            FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+}
+
+void futexWakeAll(atomic<uint32_t>& word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word),
+            FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#else
+
+namespace
+{
+
+struct WaitBucket
+{
+    mutex mtx;
+    condition_variable cv;
+};
+
+WaitBucket& waitBucket(const void* address)
+{
+    static WaitBucket buckets[16];
+    return buckets[(reinterpret_cast<uintptr_t>(address) >> 4) % 16];
+}
+
+} // anonymous namespace
+
+void futexWait(atomic<uint32_t>& word, uint32_t expected)
+{
+    WaitBucket& bucket = waitBucket(&word);
+    unique_lock<mutex> lock(bucket.mtx);
+    if (word.load() == expected)
+        bucket.cv.wait(lock);
+}
+
+void futexWaitFor(atomic<uint32_t>& word, uint32_t expected,
+                  chrono::nanoseconds timeout)
+{
+    WaitBucket& bucket = waitBucket(&word);
+    unique_lock<mutex> lock(bucket.mtx);
+    if (word.load() == expected)
+        bucket.cv.wait_for(lock, timeout);
+}
+
+void futexWakeAll(atomic<uint32_t>& word)
+{
+    // Locking the bucket makes sure that a waiter has either seen the
+    // modified word or is blocked on the CV.
+    WaitBucket& bucket = waitBucket(&word);
+    bucket.mtx.lock();
+    bucket.mtx.unlock();
+    bucket.cv.notify_all();
+}
+
+#endif // FSM11_HAS_FUTEX
+
+} // namespace fsm11_detail
+
+// ----=====================================================================----
+//     ExitRequest
+// ----=====================================================================----
+
+void ExitRequest::wait()
+{
+    uint32_t state = m_state.load(memory_order_acquire);
+    while (!(state & Requested))
+    {
+        if (!(state & Waiting)
+            && !m_state.compare_exchange_weak(state, state | Waiting,
+                                              memory_order_acq_rel,
+                                              memory_order_acquire))
+        {
+            continue;
+        }
+        fsm11_detail::futexWait(m_state, Waiting);
+        state = m_state.load(memory_order_acquire);
+    }
+}
+
+bool ExitRequest::doWaitFor(chrono::nanoseconds timeout)
+{
+    auto deadline = chrono::steady_clock::now() + timeout;
+    uint32_t state = m_state.load(memory_order_acquire);
+    while (!(state & Requested))
+    {
+        if (!(state & Waiting)
+            && !m_state.compare_exchange_weak(state, state | Waiting,
+                                              memory_order_acq_rel,
+                                              memory_order_acquire))
+        {
+            continue;
+        }
+
+        auto remaining = chrono::duration_cast<chrono::nanoseconds>(
+                             deadline - chrono::steady_clock::now());
+        if (remaining <= chrono::nanoseconds::zero())
+            return false;
+        fsm11_detail::futexWaitFor(m_state, Waiting, remaining);
+        state = m_state.load(memory_order_acquire);
+    }
+    return true;
+}
+
+void ExitRequest::request()
+{
+    uint32_t previous = m_state.fetch_or(Requested, memory_order_acq_rel);
+    if (previous & Requested)
+        return;
+    if (previous & Waiting)
+        fsm11_detail::futexWakeAll(m_state);
+
+    // The callbacks are executed without holding the lock, such that they
+    // can be unregistered concurrently.
+    unique_lock<mutex> lock(m_callbackMutex);
+    m_executingThread = this_thread::get_id();
+    while (m_callbacks)
+    {
+        fsm11_detail::ExitCallbackBase* callback = m_callbacks;
+        m_callbacks = callback->m_next;
+        m_executingCallback = callback;
+        lock.unlock();
+        callback->execute();
+        lock.lock();
+        m_executingCallback = nullptr;
+        callback->m_done.store(1, memory_order_release);
+        fsm11_detail::futexWakeAll(callback->m_done);
+    }
+}
+
+bool ExitRequest::addCallback(fsm11_detail::ExitCallbackBase* callback)
+{
+    lock_guard<mutex> lock(m_callbackMutex);
+    if (m_state.load(memory_order_acquire) & Requested)
+        return false;
+
+    callback->m_next = m_callbacks;
+    m_callbacks = callback;
+    return true;
+}
+
+void ExitRequest::removeCallback(fsm11_detail::ExitCallbackBase* callback)
+{
+    unique_lock<mutex> lock(m_callbackMutex);
+    for (auto iter = &m_callbacks; *iter; iter = &(*iter)->m_next)
+    {
+        if (*iter == callback)
+        {
+            *iter = callback->m_next;
+            return;
+        }
+    }
+
+    // A callback, which unregisters itself during its execution, must not
+    // wait for itself.
+    if (m_executingCallback == callback
+        && m_executingThread != this_thread::get_id())
+    {
+        lock.unlock();
+        while (callback->m_done.load(memory_order_acquire) == 0)
+            fsm11_detail::futexWait(callback->m_done, 0);
+    }
+}
+
 } // namespace fsm11
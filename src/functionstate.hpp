@@ -56,7 +56,8 @@ class FunctionState : public State<TStateMachine>
 
 public:
     using event_type = typename options::event_type;
-    using function_type = std::function<void(event_type)>;
+    using event_argument_type = typename base_type::event_argument_type;
+    using function_type = std::function<void(event_argument_type)>;
     using type = FunctionState<TStateMachine>;
 
     explicit
@@ -138,14 +139,14 @@ public:
     }
 
     virtual
-    void onEntry(event_type event) override
+    void onEntry(event_argument_type event) override
     {
         if (m_entryFunction)
             m_entryFunction(event);
     }
 
     virtual
-    void onExit(event_type event) override
+    void onExit(event_argument_type event) override
     {
         if (m_exitFunction)
             m_exitFunction(event);
@@ -30,8 +30,15 @@
 #define FSM11_OPTIONS_HPP
 
 #include "statemachine_fwd.hpp"
+#include "variantevent.hpp"
 #include "detail/meta.hpp"
 
+#ifdef FSM11_USE_WEOS
+#include <weos/chrono.hpp>
+#else
+#include <chrono>
+#endif // FSM11_USE_WEOS
+
 #include <deque>
 #include <memory>
 
@@ -55,13 +62,21 @@ struct default_options
     using event_list_type = std::deque<int>;
     using capture_storage = type_list<>;
     using transition_allocator_type = std::allocator<Transition<void>>;
+    using timer_clock_type = std::chrono::steady_clock;
+    using timer_tick_type = std::chrono::milliseconds;
 
     // Behavior
     static constexpr bool synchronous_dispatch = true;
+    static constexpr bool executor_dispatch = false;
+    static constexpr bool persistent_event_loop = false;
+    static constexpr std::size_t event_loop_batch_size = 1;
     static constexpr bool multithreading_enable = false;
     static constexpr TransitionConflictPolicyEnum transition_conflict_policy = Ignore;
     static constexpr bool transition_selection_stops_after_first_match = true;
     static constexpr bool threadpool_enable = false;
+    static constexpr bool pass_events_by_reference = false;
+    static constexpr bool hierarchical_event_matching = false;
+    static constexpr bool timer_service_enable = false;
 
     // Callbacks
     static constexpr bool event_callbacks_enable = false;
@@ -91,6 +106,24 @@ struct EventType
     //! \endcond
 };
 
+//! \brief Uses a closed set of event types.
+//!
+//! The event type of the state machine becomes a VariantEvent<TTypes...>.
+//! Transitions are looked up by the type of the event and guards and
+//! actions can take the concrete event type. As with EventType, the
+//! event list has to be set with EventListType.
+template <typename... TTypes>
+struct EventTypes
+{
+    //! \cond
+    template <typename TBase>
+    struct pack : TBase
+    {
+        using event_type = VariantEvent<TTypes...>;
+    };
+    //! \endcond
+};
+
 template <typename TType>
 struct EventListType
 {
@@ -138,6 +171,7 @@ struct SynchronousEventDispatching
     struct pack : TBase
     {
         static constexpr bool synchronous_dispatch = true;
+        static constexpr bool executor_dispatch = false;
     };
     //! \endcond
 };
@@ -149,6 +183,68 @@ struct AsynchronousEventDispatching
     struct pack : TBase
     {
         static constexpr bool synchronous_dispatch = false;
+        static constexpr bool executor_dispatch = false;
+    };
+    //! \endcond
+};
+
+//! \brief Dispatches the events in an executor.
+//!
+//! The state machine is run by an Executor, which is passed to its
+//! constructor. Instead of blocking a thread in an event loop, the state
+//! machine schedules itself in the executor, whenever it has a pending
+//! event or a start or stop request. So many state machines can share a
+//! few threads. The executor must run as long as a scheduled state machine
+//! exists.
+struct ExecutorEventDispatching
+{
+    //! \cond
+    template <typename TBase>
+    struct pack : TBase
+    {
+        static constexpr bool synchronous_dispatch = false;
+        static constexpr bool executor_dispatch = true;
+    };
+    //! \endcond
+};
+
+//! \brief Keeps the event loop alive across stop and start.
+//!
+//! If \p TEnable is set, the event loop of an asynchronous state machine
+//! does not return, when the state machine is stopped. Instead, it waits
+//! for the next start request. So a state machine can be restarted
+//! without spawning a new thread. The event loop is left with
+//! \p exitEventLoop() or when the state machine is destroyed.
+template <bool TEnable>
+struct PersistentEventLoop
+{
+    //! \cond
+    template <typename TBase>
+    struct pack : TBase
+    {
+        static constexpr bool persistent_event_loop = TEnable;
+    };
+    //! \endcond
+};
+
+//! \brief Dispatches the events in batches.
+//!
+//! The event loop of an asynchronous state machine moves up to \p TSize
+//! events out of the event list at once and dispatches them while holding
+//! the state machine's lock. A stop request is handled after the batch.
+//! A larger batch reduces the synchronization per event but increases
+//! the latency of a stop request and of events, which are ordered by
+//! priority.
+template <std::size_t TSize>
+struct EventLoopBatchSize
+{
+    static_assert(TSize > 0, "The batch size must be non-zero.");
+
+    //! \cond
+    template <typename TBase>
+    struct pack : TBase
+    {
+        static constexpr std::size_t event_loop_batch_size = TSize;
     };
     //! \endcond
 };
@@ -190,6 +286,69 @@ struct TransitionSelectionStopsAfterFirstMatch
     //! \endcond
 };
 
+//! \brief Passes events by reference.
+//!
+//! If \p TEnable is set, events are moved out of the event list once and
+//! are passed as <tt>const event_type&</tt> to guards, actions, the entry
+//! and exit functions of states and to the event callbacks. Otherwise, each
+//! of these functions receives a copy of the event.
+template <bool TEnable>
+struct PassEventsByReference
+{
+    //! \cond
+    template <typename TBase>
+    struct pack : TBase
+    {
+        static constexpr bool pass_events_by_reference = TEnable;
+    };
+    //! \endcond
+};
+
+//! \brief Matches events by their prefix.
+//!
+//! If \p TEnable is set, the events are strings of dot-separated tokens
+//! and the event of a transition is an SCXML event descriptor. The
+//! transition is triggered by every event starting with the tokens of the
+//! descriptor, e.g. <tt>event("net.tcp")</tt> or <tt>event("net.tcp.*")</tt>
+//! match <tt>"net.tcp.reset"</tt>. The descriptor <tt>"*"</tt> matches all
+//! events. The candidate transitions are looked up in a trie, which is
+//! built together with the state table.
+template <bool TEnable>
+struct HierarchicalEventMatching
+{
+    //! \cond
+    template <typename TBase>
+    struct pack : TBase
+    {
+        static constexpr bool hierarchical_event_matching = TEnable;
+    };
+    //! \endcond
+};
+
+//! \brief Enables the timer service.
+//!
+//! If \p TEnable is set, the state machine can send events to itself after
+//! a delay or at a point in time measured by the clock \p TClock. The timers
+//! are kept in a hierarchical timer wheel, which advances in steps of
+//! \p TTick. An asynchronous state machine processes the timers in its event
+//! loop. A synchronous state machine has to be driven by calling
+//! \p processTimers().
+template <bool TEnable,
+          typename TClock = std::chrono::steady_clock,
+          typename TTick = std::chrono::milliseconds>
+struct TimerServiceEnable
+{
+    //! \cond
+    template <typename TBase>
+    struct pack : TBase
+    {
+        static constexpr bool timer_service_enable = TEnable;
+        using timer_clock_type = TClock;
+        using timer_tick_type = TTick;
+    };
+    //! \endcond
+};
+
 template <bool TEnable, std::size_t... TNumPools>
 struct ThreadPoolEnable;
 
@@ -216,6 +375,30 @@ struct ThreadPoolEnable<true, TNumPools>
     {
         static constexpr bool threadpool_enable = true;
         static constexpr std::size_t thread_pool_size = TNumPools;
+        static constexpr std::size_t thread_pool_max_size = 0;
+    };
+    //! \endcond
+};
+
+//! \brief Enables an elastic thread pool.
+//!
+//! The invoke actions are run in an ElasticThreadPool, which has between
+//! \p TMinSize and \p TMaxSize workers. Invoke actions are queued, when
+//! the maximum number of workers is busy.
+template <std::size_t TMinSize, std::size_t TMaxSize>
+struct ThreadPoolEnable<true, TMinSize, TMaxSize>
+{
+    static_assert(TMaxSize > 0, "The pool size must be non-zero.");
+    static_assert(TMinSize <= TMaxSize,
+                  "The minimum size must not exceed the maximum size.");
+
+    //! \cond
+    template <typename TBase>
+    struct pack : TBase
+    {
+        static constexpr bool threadpool_enable = true;
+        static constexpr std::size_t thread_pool_size = TMinSize;
+        static constexpr std::size_t thread_pool_max_size = TMaxSize;
     };
     //! \endcond
 };
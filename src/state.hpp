@@ -31,6 +31,7 @@
 
 #include "statemachine_fwd.hpp"
 #include "error.hpp"
+#include "detail/statetable.hpp"
 
 #ifdef FSM11_USE_WEOS
 #include <weos/atomic.hpp>
@@ -44,6 +45,7 @@
 #include <type_traits>
 #endif // FSM11_USE_WEOS
 
+#include <cstdint>
 #include <cstring>
 #include <iterator>
 
@@ -73,6 +75,11 @@ class State
 
 public:
     using event_type = typename options::event_type;
+    //! The type in which an event is passed to onEntry() and onExit().
+    //! This is either \p event_type or <tt>const event_type&</tt> (see
+    //! PassEventsByReference).
+    using event_argument_type
+        = typename fsm11_detail::get_event_argument_type<options>::type;
     using state_machine_type = TStateMachine;
     using transition_type = Transition<TStateMachine>;
     using type = State<TStateMachine>;
@@ -177,7 +184,7 @@ public:
     //! is entered. The event which triggered the configuration change
     //! is passed in \p event. The default implementation does nothing.
     virtual
-    void onEntry(event_type /*event*/)
+    void onEntry(event_argument_type /*event*/)
     {
         // The default implementation does nothing.
     }
@@ -188,7 +195,7 @@ public:
     //! The event which triggered the configuration change is passed in
     //! \p event. The default implementation does nothing.
     virtual
-    void onExit(event_type /*event*/)
+    void onExit(event_argument_type /*event*/)
     {
         // The default implementation does nothing.
     }
@@ -236,6 +243,7 @@ public:
     {
         m_flags &= ~ChildModeFlag;
         m_flags |= static_cast<int>(mode);
+        markHierarchyChanged();
     }
 
     //! \brief Sets the initial state.
@@ -1133,8 +1141,7 @@ private:
         SkipTransitionSelection = 0x100,
         InEnterSet              = 0x200,
         InExitSet               = 0x400,
-        PartOfConflict          = 0x800,
-        Transient               = 0xF00,
+        Transient               = 0x700,
 
         ChildModeFlag           = 0x001,
         ShallowHistory          = 0x002,
@@ -1163,6 +1170,15 @@ private:
     //! The flags.
     //! \todo This should be of type Flags
     int m_flags;
+    //! The index of this state in the state machine's state table.
+    std::uint32_t m_index;
+
+    //! Notifies the state machine that its hierarchy has changed.
+    void markHierarchyChanged() noexcept
+    {
+        if (m_stateMachine)
+            m_stateMachine->invalidateStateTable();
+    }
 
     //! Adds a \p child.
     void addChild(State* child) noexcept;
@@ -1180,6 +1196,12 @@ private:
     template <typename TDerived>
     friend class fsm11_detail::EventDispatcherBase;
 
+    template <typename T>
+    friend class fsm11_detail::StateTable;
+
+    template <typename T>
+    friend struct fsm11_detail::StateTableLookup;
+
     template <typename T>
     friend class ShallowHistoryState;
 
@@ -1196,7 +1218,8 @@ State<TStateMachine>::State(const char* name, State* parent) noexcept
       m_nextSibling(nullptr),
       m_initialState(nullptr),
       m_originatingTransitions(nullptr),
-      m_flags(0)
+      m_flags(0),
+      m_index(0)
 {
     if (parent)
         parent->addChild(this);
@@ -1238,16 +1261,12 @@ State<TStateMachine>* State<TStateMachine>::findDescendant(
 template <typename TStateMachine>
 void State<TStateMachine>::setInitialState(State* descendant)
 {
-    if (!descendant)
-    {
-        m_initialState = nullptr;
-        return;
-    }
-
-    if (!isProperAncestor(this, descendant))
+    if (descendant && !isProperAncestor(this, descendant))
         throw FSM11_EXCEPTION(Error(ErrorCode::InvalidStateRelationship));
 
     m_initialState = descendant;
+    // The cached entry sets of the transitions depend on the initial state.
+    markHierarchyChanged();
 }
 
 template <typename TStateMachine>
@@ -1278,6 +1297,7 @@ void State<TStateMachine>::addChild(State* child) noexcept
 {
     FSM11_ASSERT(child->m_nextSibling == nullptr);
 
+    markHierarchyChanged();
     if (!m_children)
     {
         m_children = child;
@@ -1296,6 +1316,7 @@ void State<TStateMachine>::removeChild(State* child) noexcept
 {
     FSM11_ASSERT(m_children != nullptr);
 
+    markHierarchyChanged();
     if (child == m_children)
         m_children = child->m_nextSibling;
     else
@@ -1320,6 +1341,7 @@ template <typename TStateMachine>
 void State<TStateMachine>::pushBackTransition(
         transition_type* transition) noexcept
 {
+    markHierarchyChanged();
     if (!m_originatingTransitions)
     {
         m_originatingTransitions = transition;
@@ -1360,6 +1382,16 @@ template <typename TStateMachine>
 State<TStateMachine>* findLeastCommonProperAncestor(
         State<TStateMachine>* state1, State<TStateMachine>* state2) noexcept
 {
+    using lookup_type = fsm11_detail::StateTableLookup<TStateMachine>;
+    using index_type = typename lookup_type::index_type;
+
+    index_type idx1, idx2;
+    if (auto table = lookup_type::find(state1, state2, idx1, idx2))
+    {
+        index_type lcpa = table->leastCommonProperAncestor(idx1, idx2);
+        return lcpa != table->npos ? table->state(lcpa) : nullptr;
+    }
+
     while ((state1 = state1->parent()) != nullptr)
     {
         if (isProperAncestor(state1, state2))
@@ -1377,8 +1409,15 @@ template <typename TStateMachine>
 bool isAncestor(const State<TStateMachine>* ancestor,
                 const State<TStateMachine>* descendant) noexcept
 {
+    using lookup_type = fsm11_detail::StateTableLookup<TStateMachine>;
+    using index_type = typename lookup_type::index_type;
+
     if (!ancestor->isAtomic())
     {
+        index_type idx1, idx2;
+        if (auto table = lookup_type::find(ancestor, descendant, idx1, idx2))
+            return table->isAncestor(idx1, idx2);
+
         while (descendant)
         {
             if (ancestor == descendant)
@@ -1398,8 +1437,15 @@ template <typename TStateMachine>
 bool isProperAncestor(const State<TStateMachine>* ancestor,
                       const State<TStateMachine>* descendant) noexcept
 {
+    using lookup_type = fsm11_detail::StateTableLookup<TStateMachine>;
+    using index_type = typename lookup_type::index_type;
+
     if (!ancestor->isAtomic())
     {
+        index_type idx1, idx2;
+        if (auto table = lookup_type::find(ancestor, descendant, idx1, idx2))
+            return idx1 != idx2 && table->isAncestor(idx1, idx2);
+
         while ((descendant = descendant->parent()) != nullptr)
         {
             if (ancestor == descendant)
@@ -38,12 +38,16 @@
 #include "detail/eventdispatcher.hpp"
 #include "detail/meta.hpp"
 #include "detail/multithreading.hpp"
+#include "detail/statetable.hpp"
 #include "detail/threadpool.hpp"
+#include "detail/timerservice.hpp"
 
 #ifdef FSM11_USE_WEOS
+#include <weos/memory.hpp>
 #include <weos/mutex.hpp>
 #include <weos/type_traits.hpp>
 #else
+#include <memory>
 #include <mutex>
 #include <type_traits>
 #endif // FSM11_USE_WEOS
@@ -372,6 +376,7 @@ class StateMachineImpl :
         public get_state_callbacks<TOptions>::type,
         public get_state_exception_callbacks<TOptions>::type,
         public get_threadpool<TOptions>::type,
+        public get_timer_service<TOptions>::type,
         public get_transition_conflict_action<TOptions>::type,
         public State<StateMachineImpl<TOptions>>
 {
@@ -385,6 +390,7 @@ public:
 
 private:
     using dispatcher_type = typename get_dispatcher<TOptions>::type;
+    using threadpool_base = typename get_threadpool<TOptions>::type;
     using rebound_transition_allocator_t
         = typename transition_allocator_type::
           template rebind<transition_type>::other;
@@ -400,13 +406,75 @@ public:
         state_type::m_stateMachine = this;
     }
 
+    //! \brief Constructs a state machine, which owns a thread pool.
+    //!
+    //! The invoke actions are run in the given \p pool, which is moved
+    //! into the state machine.
     template <typename T = void,
               typename = typename std::enable_if<
                              TOptions::threadpool_enable, T>::type>
     explicit
     StateMachineImpl(internal_thread_pool_type&& pool)
-        : state_type("(StateMachine)"),
-          m_threadPool(std::move(pool))
+        : threadpool_base(std::move(pool)),
+          state_type("(StateMachine)")
+    {
+        state_type::m_stateMachine = this;
+    }
+
+    //! \brief Constructs a state machine with a shared thread pool.
+    //!
+    //! The invoke actions are run in the given \p pool, which can be
+    //! shared by many state machines. The pool must outlive the state
+    //! machine.
+    //!
+    //! Only an ElasticThreadPool can be shared. A ThreadPool with a fixed
+    //! size throws a ThreadPoolUnderflow error, when all its threads are
+    //! busy. This happens easily, if the invoke actions of many state
+    //! machines run in it. An ElasticThreadPool queues them instead.
+    template <typename T = void,
+              typename = typename std::enable_if<
+                             TOptions::threadpool_enable, T>::type>
+    explicit
+    StateMachineImpl(internal_thread_pool_type& pool)
+        : threadpool_base(pool),
+          state_type("(StateMachine)")
+    {
+        static_assert(TOptions::thread_pool_max_size != 0,
+                      "Only an elastic thread pool can be shared.");
+        state_type::m_stateMachine = this;
+    }
+
+    //! \brief Constructs a state machine with a shared thread pool.
+    //!
+    //! The invoke actions are run in the given \p pool, which can be
+    //! shared by many state machines. The state machine keeps the pool
+    //! alive. Like above, the pool has to be an ElasticThreadPool.
+    template <typename T = void,
+              typename = typename std::enable_if<
+                             TOptions::threadpool_enable, T>::type>
+    explicit
+    StateMachineImpl(std::shared_ptr<internal_thread_pool_type> pool)
+        : threadpool_base(std::move(pool)),
+          state_type("(StateMachine)")
+    {
+        static_assert(TOptions::thread_pool_max_size != 0,
+                      "Only an elastic thread pool can be shared.");
+        state_type::m_stateMachine = this;
+    }
+
+    //! \brief Constructs a state machine, which is run by an executor.
+    //!
+    //! The state machine is dispatched in the given \p executor (see
+    //! ExecutorEventDispatching). The executor should outlive the state
+    //! machine. If the executor is destroyed first, the state machine is
+    //! not run any more and it may only be destroyed.
+    template <typename T = void,
+              typename = typename std::enable_if<
+                             TOptions::executor_dispatch, T>::type>
+    explicit
+    StateMachineImpl(Executor& executor)
+        : dispatcher_type(executor),
+          state_type("(StateMachine)")
     {
         state_type::m_stateMachine = this;
     }
@@ -420,6 +488,11 @@ public:
     }
 
     //! \brief Destroys the state machine.
+    //!
+    //! A running state machine is stopped, which calls the exit actions and
+    //! leaves the invoke actions of the active states. Afterwards, the
+    //! transitions of all states are deleted. The states must therefore
+    //! outlive the state machine.
     virtual
     ~StateMachineImpl()
     {
@@ -506,20 +579,32 @@ public:
     template <typename... TStates>
     bool areAllActive(const state_type& state, const TStates&... states) const noexcept;
 
+    //! \brief Freezes the state hierarchy.
+    //!
+    //! Compiles the state hierarchy and the transitions into a flat table,
+    //! which the dispatcher walks instead of the linked states. The table
+    //! is built when the state machine is started and it is rebuilt before
+    //! the next event is dispatched whenever a state or a transition has been
+    //! added or removed in the meantime. Calling this method moves the cost of
+    //! building the table out of the dispatch path.
+    void freeze();
+
+    //! \brief Returns the event list.
+    //!
+    //! The event list is guarded by the state machine. It must not be
+    //! inspected while events are added or dispatched, unless the list
+    //! allows it explicitly (like RingBufferEventList::statistics()).
+    const event_list_type& eventList() const noexcept
+    {
+        return m_eventList;
+    }
+
 private:
     //! A list of events which have to be handled by the event loop.
     event_list_type m_eventList;
     //! The allocator for transitions.
     rebound_transition_allocator_t m_transitionAllocator;
 
-    internal_thread_pool_type m_threadPool; // TODO: merge if empty
-
-
-    internal_thread_pool_type& threadPool()
-    {
-        return m_threadPool;
-    }
-
 
 
     template <typename... TStates>
@@ -552,12 +637,16 @@ private:
 
 
     friend class EventDispatcherBase<StateMachineImpl>;
+    friend state_type;
 
     template <typename T>
     friend class fsm11::ThreadedState;
 
     template <typename T>
     friend class WithThreadPool;
+
+    template <typename T>
+    friend class WithTimerService;
 };
 
 template <typename TOptions>
@@ -587,6 +676,13 @@ auto StateMachineImpl<TOptions>::add(
     return transition;
 }
 
+template <typename TOptions>
+void StateMachineImpl<TOptions>::freeze()
+{
+    auto lock = this->getLock();
+    this->updateStateTable();
+}
+
 template <typename TOptions>
 bool StateMachineImpl<TOptions>::isActive() const noexcept
 {
@@ -721,8 +817,44 @@ public:
     using transition_type = Transition<TOptions>;
 
 
-    //! Adds another \p event to the state machine.
-    void addEvent(event_type event);
+    //! Adds another \p event to the state machine. Returns \p false, if
+    //! a bounded event list has rejected the event.
+    bool addEvent(event_type event);
+
+    //! Adds the events in the range <tt>[first, last)</tt> to the state
+    //! machine with a single lock acquisition.
+    template <typename TInputIterator>
+    void addEvents(TInputIterator first, TInputIterator last);
+
+    //! Adds all events of the \p range to the state machine.
+    template <typename TRange>
+    void addEvents(const TRange& range);
+
+    //! Adds the given \p events to the state machine.
+    void addEvents(std::initializer_list<event_type> events);
+
+    //! Raises the internal \p event. Internal events are dispatched before
+    //! the next event from the event list. This function must only be called
+    //! from within the state machine, e.g. from an action.
+    void raise(event_type event);
+
+    //! Sends the \p event to the state machine after the given \p delay.
+    //! Returns a handle to cancel the timer. Requires the timer service.
+    TimerHandle sendAfter(event_type event, duration delay);
+
+    //! Sends the \p event to the state machine at the \p expiry time.
+    //! Returns a handle to cancel the timer. Requires the timer service.
+    TimerHandle sendAt(event_type event, time_point expiry);
+
+    //! Cancels the timer referred to by the \p handle.
+    bool cancelTimer(const TimerHandle& handle);
+
+    //! Adds the events of the expired timers. A synchronous state machine
+    //! has to call this function to drive its timers.
+    std::size_t processTimers();
+
+    //! Returns the event list.
+    const event_list_type& eventList() const noexcept;
 
     //! Starts the state machine.
     void start();
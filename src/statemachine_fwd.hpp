@@ -60,6 +60,12 @@
 #endif // FSM11_USE_WEOS
 
 
+#ifdef FSM11_USE_WEOS
+#include <weos/type_traits.hpp>
+#else
+#include <type_traits>
+#endif // FSM11_USE_WEOS
+
 #include <cstddef>
 
 namespace fsm11
@@ -83,6 +89,9 @@ class ThreadedFunctionState;
 template <std::size_t TSize>
 class ThreadPool;
 
+template <std::size_t TMinSize, std::size_t TMaxSize>
+class ElasticThreadPool;
+
 template <typename TStateMachine>
 class Transition;
 
@@ -92,9 +101,18 @@ namespace fsm11_detail
 template <typename TDerived>
 class EventDispatcherBase;
 
+template <typename TDerived>
+class WithTimerService;
+
 template <typename TOptions>
 class StateMachineImpl;
 
+template <typename TStateMachine>
+class StateTable;
+
+template <typename TStateMachine>
+struct StateTableLookup;
+
 
 template <typename TType>
 struct get_options;
@@ -105,6 +123,17 @@ struct get_options<StateMachineImpl<TOptions>>
     typedef TOptions type;
 };
 
+//! Determines how an event is passed to guards, actions, the entry and exit
+//! functions of states and to the event callbacks.
+template <typename TOptions>
+struct get_event_argument_type
+{
+    using type = typename std::conditional<
+                     TOptions::pass_events_by_reference,
+                     const typename TOptions::event_type&,
+                     typename TOptions::event_type>::type;
+};
+
 } // namespace fsm11_detail
 
 template <typename TStateMachine>
@@ -58,7 +58,8 @@ class ThreadedFunctionState : public FunctionState<TStateMachine>
 
 public:
     using event_type = typename options::event_type;
-    using function_type = std::function<void(event_type)>;
+    using event_argument_type = typename base_type::event_argument_type;
+    using function_type = std::function<void(event_argument_type)>;
     using invoke_function_type = std::function<void(ExitRequest& exitRequest)>;
     using type = ThreadedFunctionState<TStateMachine>;
 
@@ -180,9 +181,7 @@ public:
     virtual
     void enterInvoke() override
     {
-        m_exitRequest.m_mutex.lock();
-        m_exitRequest.m_requested = false;
-        m_exitRequest.m_mutex.unlock();
+        m_exitRequest.reset();
 
         m_exceptionPointer = nullptr;
 #ifdef FSM11_USE_WEOS
@@ -200,10 +199,7 @@ public:
     {
         FSM11_ASSERT(m_invokeThread.joinable());
 
-        m_exitRequest.m_mutex.lock();
-        m_exitRequest.m_requested = true;
-        m_exitRequest.m_mutex.unlock();
-        m_exitRequest.m_cv.notify_one();
+        m_exitRequest.request();
 
         m_invokeThread.join();
         return m_exceptionPointer;
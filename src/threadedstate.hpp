@@ -32,14 +32,19 @@
 #include "statemachine_fwd.hpp"
 #include "exitrequest.hpp"
 #include "state.hpp"
+#include "detail/scopeguard.hpp"
 #include "detail/threadedstatebase.hpp"
 
 #ifdef FSM11_USE_WEOS
-#include <weos/future.hpp>
+#include <weos/exception.hpp>
+#include <weos/thread.hpp>
 #include <weos/tuple.hpp>
+#include <weos/type_traits.hpp>
 #else
-#include <future>
+#include <exception>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 #endif // FSM11_USE_WEOS
 
 namespace fsm11
@@ -101,64 +106,99 @@ public:
     virtual
     void enterInvoke() override final
     {
-        m_exitRequest.m_mutex.lock();
-        m_exitRequest.m_requested = false;
-        m_exitRequest.m_mutex.unlock();
+        m_exitRequest.reset();
 
         doEnterInvoke(std::integral_constant<bool, has_thread_pool>());
     }
 
     //! Leaves the invoked thread.
     //!
-    //! Joins with the thread in which the invoked action is running.
+    //! Joins with the invoke action. An exception thrown by the invoke
+    //! action is rethrown.
     virtual
     void exitInvoke() override final
     {
-        m_exitRequest.m_mutex.lock();
-        m_exitRequest.m_requested = true;
-        m_exitRequest.m_mutex.unlock();
-        m_exitRequest.m_cv.notify_one();
+        m_exitRequest.request();
 
-        std::get<0>(m_data).get();
+        doExitInvoke(std::integral_constant<bool, has_thread_pool>());
+        m_invokeHandle.join();
     }
 
 private:
-#ifdef FSM11_USE_WEOS
     struct None {};
 
+#ifdef FSM11_USE_WEOS
+    using maybe_thread_t
+        = typename std::conditional<!has_thread_pool,
+                                    weos::thread,
+                                    None>::type;
+
     using maybe_thread_attributes_t
         = typename std::conditional<!has_thread_pool,
                                          weos::thread_attributes,
                                          None>::type;
 
-    using data_type = std::tuple<std::future<void>,
+    using data_type = std::tuple<maybe_thread_t,
                                  maybe_thread_attributes_t>;
 #else
-    using data_type = std::tuple<std::future<void>>;
+    using maybe_thread_t
+        = typename std::conditional<!has_thread_pool,
+                                    std::thread,
+                                    None>::type;
+
+    using data_type = std::tuple<maybe_thread_t>;
 #endif // FSM11_USE_WEOS
 
     data_type m_data;
 
 
+    //! Runs the invoke action in the thread of this state and completes
+    //! the invoke handle.
+    void runInvoke()
+    {
+        std::exception_ptr exception;
+        try
+        {
+            invoke(m_exitRequest);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        m_invokeHandle.complete(std::move(exception));
+    }
+
     void doEnterInvoke(std::false_type)
     {
         using namespace std;
 
+        m_invokeHandle.start();
+        FSM11_SCOPE_FAILURE { m_invokeHandle.complete(); };
 #ifdef FSM11_USE_WEOS
-        get<0>(m_data) = weos::async(launch::async,
-                                     get<1>(m_data),
-                                     &ThreadedStateBase::invoke,
-                                     this, ref(this->m_exitRequest));
+        get<0>(m_data) = weos::thread(get<1>(m_data),
+                                      &ThreadedState::runInvoke, this);
 #else
-        get<0>(m_data) = async(launch::async,
-                               &ThreadedStateBase::invoke,
-                               this, ref(this->m_exitRequest));
+        get<0>(m_data) = thread(&ThreadedState::runInvoke, this);
 #endif // FSM11_USE_WEOS
     }
 
     void doEnterInvoke(std::true_type)
     {
-        std::get<0>(m_data) = this->stateMachine()->threadPool().enqueue(*this);
+        this->stateMachine()->threadPool().enqueue(*this);
+    }
+
+    void doExitInvoke(std::false_type)
+    {
+        if (std::get<0>(m_data).joinable())
+            std::get<0>(m_data).join();
+    }
+
+    //! A pool may have queued the invoke action because all workers are
+    //! busy. It must not wait for a worker as the busy workers might wait
+    //! for this state machine.
+    void doExitInvoke(std::true_type)
+    {
+        this->stateMachine()->threadPool().cancel(*this);
     }
 };
 
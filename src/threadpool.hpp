@@ -36,15 +36,17 @@
 
 #ifdef FSM11_USE_WEOS
 #include <boost/container/static_vector.hpp>
+#include <weos/chrono.hpp>
 #include <weos/condition_variable.hpp>
-#include <weos/future.hpp>
+#include <weos/memory.hpp>
 #include <weos/mutex.hpp>
 #include <weos/thread.hpp>
 #include <weos/tuple.hpp>
 #include <weos/utility.hpp>
 #else
+#include <chrono>
 #include <condition_variable>
-#include <future>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <utility>
@@ -60,26 +62,6 @@ class ThreadPool
 {
     static_assert(TSize > 0, "The thread pool must be non-empty.");
 
-    struct Task
-    {
-        Task(fsm11_detail::ThreadedStateBase& s)
-            : state(s)
-        {
-        }
-
-        Task(Task&& other)
-            : promise(std::move(other.promise)),
-              state(other.state)
-        {
-        }
-
-        Task(const Task&) = delete;
-        Task& operator=(const Task&) = delete;
-
-        std::promise<void> promise;
-        fsm11_detail::ThreadedStateBase& state;
-    };
-
     struct Handle
     {
         explicit
@@ -123,7 +105,16 @@ public:
     //! Move-assigns the \p other pool to this one.
     ThreadPool& operator=(ThreadPool&& other);
 
-    std::future<void> enqueue(fsm11_detail::ThreadedStateBase& state);
+    //! Enqueues the invoke action of the given \p state. The completion
+    //! is signalled through the invoke handle of the \p state. Throws
+    //! an exception if there is no idle worker.
+    void enqueue(fsm11_detail::ThreadedStateBase& state);
+
+    //! Does nothing. In contrast to the ElasticThreadPool, this pool has
+    //! an idle worker for every enqueued invoke action.
+    void cancel(fsm11_detail::ThreadedStateBase&) noexcept
+    {
+    }
 
 private:
     std::mutex m_poolMutex;
@@ -135,9 +126,9 @@ private:
     std::size_t m_idleWorkers{TSize};
     Handle* m_handles{nullptr};
 #ifdef FSM11_USE_WEOS
-    boost::container::static_vector<Task, TSize> m_tasks;
+    boost::container::static_vector<fsm11_detail::ThreadedStateBase*, TSize> m_tasks;
 #else
-    std::vector<Task> m_tasks;
+    std::vector<fsm11_detail::ThreadedStateBase*> m_tasks;
 #endif
 
 
@@ -284,8 +275,7 @@ auto ThreadPool<TSize>::operator=(ThreadPool&& other) -> ThreadPool&
 }
 
 template <std::size_t TSize>
-std::future<void>
-ThreadPool<TSize>::enqueue(fsm11_detail::ThreadedStateBase& state)
+void ThreadPool<TSize>::enqueue(fsm11_detail::ThreadedStateBase& state)
 {
     using namespace std;
 
@@ -294,9 +284,9 @@ ThreadPool<TSize>::enqueue(fsm11_detail::ThreadedStateBase& state)
         throw FSM11_EXCEPTION(Error(ErrorCode::ThreadPoolUnderflow));
     --m_idleWorkers;
 
-    m_tasks.emplace_back(state);
+    state.m_invokeHandle.start();
+    m_tasks.push_back(&state);
     m_workerCv.notify_one();
-    return m_tasks.back().promise.get_future();
 }
 
 template <std::size_t TSize>
@@ -325,20 +315,25 @@ void ThreadPool<TSize>::work(ThreadPool* pool, std::size_t id)
                                   || !pool->m_tasks.empty(); });
         if (!pool->m_tasks.empty())
         {
-            Task task = move(pool->m_tasks.back());
+            fsm11_detail::ThreadedStateBase* state = pool->m_tasks.back();
             pool->m_tasks.pop_back();
             lock.unlock();
+            exception_ptr exception;
             try
             {
-                task.state.invoke(task.state.m_exitRequest);
-                task.promise.set_value();
+                state->invoke(state->m_exitRequest);
             }
             catch (...)
             {
-                task.promise.set_exception(current_exception());
+                exception = current_exception();
             }
+            // The worker has to be idle before the completion is signalled.
+            // Otherwise, a state, which is re-entered immediately, might
+            // find no idle worker.
             lock.lock();
             ++pool->m_idleWorkers;
+            lock.unlock();
+            state->m_invokeHandle.complete(move(exception));
         }
         else if (handle.hasChanged(pool))
         {
@@ -386,6 +381,258 @@ auto ThreadPool<TSize>::Handle::change(ThreadPool* current, std::size_t id)
     return m_pool;
 }
 
+// ----=====================================================================----
+//     ElasticThreadPool
+// ----=====================================================================----
+
+//! \brief A thread pool, which grows and shrinks with the load.
+//!
+//! The pool keeps at least \p TMinSize workers. If an invoke action is
+//! enqueued while no worker is idle, the pool creates another worker as
+//! long as it has less than \p TMaxSize workers. Otherwise, the invoke
+//! action is queued until a worker becomes idle. A worker, which has been
+//! idle for the linger time, terminates, if there are more than
+//! \p TMinSize workers. So a burst of invoked states is absorbed without
+//! keeping the threads for the peak load.
+template <std::size_t TMinSize, std::size_t TMaxSize>
+class ElasticThreadPool
+{
+    static_assert(TMaxSize > 0, "The thread pool must be non-empty.");
+    static_assert(TMinSize <= TMaxSize,
+                  "The minimum size must not exceed the maximum size.");
+
+    //! The state, which is shared between the pool and its workers. A
+    //! moved pool does not affect the workers.
+    struct Shared
+    {
+        explicit
+        Shared(std::chrono::milliseconds linger)
+            : linger(linger)
+        {
+        }
+
+        std::mutex mutex;
+        //! This CV signals that a task has been queued or that the workers
+        //! have to exit.
+        std::condition_variable workerCv;
+        //! This CV signals that a worker has exited.
+        std::condition_variable exitCv;
+        //! The queue of invoke actions, which is linked through the
+        //! states themselves.
+        fsm11_detail::ThreadedStateBase* head{nullptr};
+        fsm11_detail::ThreadedStateBase* tail{nullptr};
+        std::size_t numTasks{0};
+        std::chrono::milliseconds linger;
+        std::size_t numWorkers{0};
+        std::size_t idleWorkers{0};
+        bool exitRequest{false};
+    };
+
+public:
+    //! \brief Constructs an elastic thread pool.
+    //!
+    //! Starts \p TMinSize workers. A worker in excess of this number
+    //! terminates after it has been idle for the \p linger time.
+    explicit
+    ElasticThreadPool(std::chrono::milliseconds linger
+                          = std::chrono::milliseconds(1000));
+
+    ElasticThreadPool(const ElasticThreadPool&) = delete;
+
+    //! Move-constructs a thread pool from the \p other pool.
+    ElasticThreadPool(ElasticThreadPool&& other) noexcept
+        : m_shared(std::move(other.m_shared))
+    {
+    }
+
+    //! Destroys the thread pool. Waits until all workers have exited.
+    ~ElasticThreadPool()
+    {
+        shutDown();
+    }
+
+    ElasticThreadPool& operator=(const ElasticThreadPool&) = delete;
+
+    //! Move-assigns the \p other pool to this one.
+    ElasticThreadPool& operator=(ElasticThreadPool&& other)
+    {
+        if (this != &other)
+        {
+            shutDown();
+            m_shared = std::move(other.m_shared);
+        }
+        return *this;
+    }
+
+    //! Enqueues the invoke action of the given \p state. The completion
+    //! is signalled through the invoke handle of the \p state.
+    void enqueue(fsm11_detail::ThreadedStateBase& state);
+
+    //! Removes the invoke action of the \p state, if it has been enqueued
+    //! but no worker has picked it up, yet. The invoke action is completed
+    //! without being run.
+    void cancel(fsm11_detail::ThreadedStateBase& state);
+
+    //! Returns the current number of workers.
+    std::size_t numWorkers() const
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        return m_shared->numWorkers;
+    }
+
+private:
+    std::shared_ptr<Shared> m_shared;
+
+    //! Starts a worker. The caller has to hold the mutex.
+    void spawn()
+    {
+        std::thread(&ElasticThreadPool::work, m_shared).detach();
+        ++m_shared->numWorkers;
+    }
+
+    void shutDown();
+
+    static void work(std::shared_ptr<Shared> shared);
+};
+
+template <std::size_t TMinSize, std::size_t TMaxSize>
+ElasticThreadPool<TMinSize, TMaxSize>::ElasticThreadPool(
+        std::chrono::milliseconds linger)
+    : m_shared(std::make_shared<Shared>(linger))
+{
+    try
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        for (std::size_t idx = 0; idx < TMinSize; ++idx)
+            spawn();
+    }
+    catch (...)
+    {
+        shutDown();
+        throw;
+    }
+}
+
+template <std::size_t TMinSize, std::size_t TMaxSize>
+void ElasticThreadPool<TMinSize, TMaxSize>::enqueue(
+        fsm11_detail::ThreadedStateBase& state)
+{
+    using namespace std;
+
+    lock_guard<mutex> lock(m_shared->mutex);
+    if (m_shared->idleWorkers <= m_shared->numTasks
+        && m_shared->numWorkers < TMaxSize)
+    {
+        spawn();
+    }
+    else
+    {
+        m_shared->workerCv.notify_one();
+    }
+
+    state.m_invokeHandle.start();
+    state.m_nextTask = nullptr;
+    if (m_shared->tail)
+        m_shared->tail->m_nextTask = &state;
+    else
+        m_shared->head = &state;
+    m_shared->tail = &state;
+    ++m_shared->numTasks;
+}
+
+template <std::size_t TMinSize, std::size_t TMaxSize>
+void ElasticThreadPool<TMinSize, TMaxSize>::cancel(
+        fsm11_detail::ThreadedStateBase& state)
+{
+    using namespace std;
+
+    lock_guard<mutex> lock(m_shared->mutex);
+    fsm11_detail::ThreadedStateBase* previous = nullptr;
+    for (auto iter = m_shared->head; iter; iter = iter->m_nextTask)
+    {
+        if (iter == &state)
+        {
+            if (previous)
+                previous->m_nextTask = state.m_nextTask;
+            else
+                m_shared->head = state.m_nextTask;
+            if (m_shared->tail == &state)
+                m_shared->tail = previous;
+            --m_shared->numTasks;
+            state.m_invokeHandle.complete();
+            return;
+        }
+        previous = iter;
+    }
+}
+
+template <std::size_t TMinSize, std::size_t TMaxSize>
+void ElasticThreadPool<TMinSize, TMaxSize>::shutDown()
+{
+    using namespace std;
+
+    if (!m_shared)
+        return;
+
+    unique_lock<mutex> lock(m_shared->mutex);
+    m_shared->exitRequest = true;
+    m_shared->workerCv.notify_all();
+    m_shared->exitCv.wait(lock, [this] { return m_shared->numWorkers == 0; });
+
+    // Complete the invoke actions, which no worker has picked up.
+    while (m_shared->head)
+    {
+        fsm11_detail::ThreadedStateBase* state = m_shared->head;
+        m_shared->head = state->m_nextTask;
+        state->m_invokeHandle.complete();
+    }
+    m_shared->tail = nullptr;
+    m_shared->numTasks = 0;
+}
+
+template <std::size_t TMinSize, std::size_t TMaxSize>
+void ElasticThreadPool<TMinSize, TMaxSize>::work(std::shared_ptr<Shared> shared)
+{
+    using namespace std;
+
+    unique_lock<mutex> lock(shared->mutex);
+    while (!shared->exitRequest)
+    {
+        if (shared->head)
+        {
+            fsm11_detail::ThreadedStateBase* state = shared->head;
+            shared->head = state->m_nextTask;
+            if (!shared->head)
+                shared->tail = nullptr;
+            --shared->numTasks;
+            lock.unlock();
+            exception_ptr exception;
+            try
+            {
+                state->invoke(state->m_exitRequest);
+            }
+            catch (...)
+            {
+                exception = current_exception();
+            }
+            state->m_invokeHandle.complete(move(exception));
+            lock.lock();
+            continue;
+        }
+
+        ++shared->idleWorkers;
+        bool woken = shared->workerCv.wait_for(
+                         lock, shared->linger,
+                         [&] { return shared->exitRequest || shared->head; });
+        --shared->idleWorkers;
+        if (!woken && shared->numWorkers > TMinSize)
+            break;
+    }
+
+    --shared->numWorkers;
+    shared->exitCv.notify_all();
+}
+
 } // namespace fsm11
 
 #endif // FSM11_THREADPOOL_HPP
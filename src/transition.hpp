@@ -30,17 +30,23 @@
 #define FSM11_TRANSITION_HPP
 
 #include "statemachine_fwd.hpp"
+#include "variantevent.hpp"
+#include "detail/timerwheel.hpp"
 
 #ifdef FSM11_USE_WEOS
+#include <weos/chrono.hpp>
 #include <weos/functional.hpp>
 #include <weos/type_traits.hpp>
 #include <weos/utility.hpp>
 #else
+#include <chrono>
 #include <functional>
 #include <type_traits>
 #include <utility>
 #endif // FSM11_USE_WEOS
 
+#include <cstdint>
+
 namespace fsm11
 {
 
@@ -52,6 +58,98 @@ struct external_t {};
 namespace fsm11_detail
 {
 
+// ----=====================================================================----
+//     Typed guards and actions
+// ----=====================================================================----
+
+//! Checks if a \p TFunction can be called with an argument of type
+//! \p TArgument.
+template <typename TFunction, typename TArgument>
+class is_callable_with
+{
+    template <typename F,
+              typename = decltype(std::declval<F&>()(
+                                      std::declval<TArgument>()))>
+    static std::true_type test(int);
+
+    template <typename F>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<TFunction>(0))::value;
+};
+
+//! Determines the type of the event in a transition specification. This
+//! is either the type of the event value or the type named by
+//! <tt>event<TType>()</tt>.
+template <typename TEvent>
+struct specified_event_type
+{
+    using type = typename std::decay<TEvent>::type;
+};
+
+template <typename TType>
+struct specified_event_type<const eventType_t<TType>&>
+{
+    using type = TType;
+};
+
+//! Wraps a guard or an action, which takes the concrete alternative
+//! \p TAlternative of a VariantEvent, such that it can be called with the
+//! VariantEvent.
+template <typename TAlternative, typename TFunction>
+struct TypedEventFunction
+{
+    TFunction function;
+
+    template <typename TEvent>
+    auto operator()(const TEvent& event)
+        -> decltype(std::declval<TFunction&>()(
+                        std::declval<const TAlternative&>()))
+    {
+        return function(event.template get<TAlternative>());
+    }
+};
+
+template <typename TEventFunction, typename TAlternative, typename TFunction>
+inline
+TEventFunction wrap_event_function(TFunction&& function, std::false_type)
+{
+    return TEventFunction(std::forward<TFunction>(function));
+}
+
+template <typename TEventFunction, typename TAlternative, typename TFunction>
+inline
+TEventFunction wrap_event_function(TFunction&& function, std::true_type)
+{
+    return TEventFunction(
+               TypedEventFunction<TAlternative,
+                                  typename std::decay<TFunction>::type>{
+                   std::forward<TFunction>(function)});
+}
+
+//! \brief Creates a guard or an action of a transition.
+//!
+//! If the event type is a VariantEvent and the \p function cannot be called
+//! with the VariantEvent but with the alternative \p TAlternative, the
+//! function is wrapped such that it receives the payload.
+template <typename TEventFunction, typename TEventArgument,
+          typename TAlternative, typename TFunction>
+inline
+TEventFunction make_event_function(TFunction&& function)
+{
+    using event_type = typename std::decay<TEventArgument>::type;
+    using function_type = typename std::decay<TFunction>::type;
+    using is_typed = std::integral_constant<
+                         bool,
+                         is_event_alternative<event_type, TAlternative>::value
+                         && !std::is_same<function_type, std::nullptr_t>::value
+                         && !is_callable_with<function_type, TEventArgument>::value
+                         && is_callable_with<function_type, const TAlternative&>::value>;
+    return wrap_event_function<TEventFunction, TAlternative>(
+               std::forward<TFunction>(function), is_typed());
+}
+
 // ----=====================================================================----
 //     Intermediate types for transitions with events
 // ----=====================================================================----
@@ -402,6 +500,84 @@ auto operator>(external_t, SourceEventGuardAction<State<TSm>, TEvent, TGuard, TA
                 true);
 }
 
+// ----=====================================================================----
+//     Timeout transitions
+// ----=====================================================================----
+
+//! The trigger of a timeout transition. It takes the place of the event in
+//! a transition specification.
+struct Timeout
+{
+    std::chrono::nanoseconds delay;
+};
+
+//! Creates the event of a transition from the event in its specification.
+//! A timeout transition has a default-constructed event.
+template <typename TEventType, typename TEvent>
+inline
+TEventType make_transition_event(TEvent&& event, std::false_type)
+{
+    return TEventType{std::forward<TEvent>(event)};
+}
+
+template <typename TEventType, typename TEvent>
+inline
+TEventType make_transition_event(TEvent&&, std::true_type)
+{
+    return TEventType();
+}
+
+template <typename TEvent>
+struct is_timeout
+        : public std::is_same<typename std::decay<TEvent>::type, Timeout>
+{
+};
+
+//! The result of after(). Like Event, it can be combined with a guard and
+//! an action.
+class TimeoutEvent
+{
+public:
+    explicit
+    TimeoutEvent(std::chrono::nanoseconds delay) noexcept
+        : m_timeout{delay}
+    {
+    }
+
+    template <typename TGuard>
+    EventGuard<const Timeout&, TGuard&&> operator[](TGuard&& guard) const noexcept
+    {
+        return EventGuard<const Timeout&, TGuard&&>(
+                   m_timeout, std::forward<TGuard>(guard));
+    }
+
+    template <typename TGuard>
+    EventGuard<const Timeout&, TGuard&&> operator()(TGuard&& guard) const noexcept
+    {
+        return EventGuard<const Timeout&, TGuard&&>(
+                   m_timeout, std::forward<TGuard>(guard));
+    }
+
+    template <typename TAction>
+    EventGuardAction<const Timeout&, std::nullptr_t&&, TAction&&> operator/(
+            TAction&& action) const noexcept
+    {
+        return EventGuardAction<const Timeout&, std::nullptr_t&&, TAction&&>(
+                   m_timeout, nullptr, std::forward<TAction>(action));
+    }
+
+    Timeout m_timeout;
+};
+
+template <typename TSm>
+inline
+auto operator+(State<TSm>& source, const TimeoutEvent& rhs) noexcept
+    -> SourceEventGuardAction<State<TSm>, const Timeout&, std::nullptr_t&&, std::nullptr_t&&>
+{
+    return SourceEventGuardAction<State<TSm>, const Timeout&, std::nullptr_t&&, std::nullptr_t&&>(
+                &source, rhs.m_timeout, nullptr, nullptr);
+}
+
 // ----=====================================================================----
 //     Intermediate types for transitions without events
 // ----=====================================================================----
@@ -715,8 +891,11 @@ class Transition
 public:
     using state_type = State<TStateMachine>;
     using event_type = typename options::event_type;
-    using action_type = std::function<void(event_type)>;
-    using guard_type = std::function<bool(event_type)>;
+    //! The type in which an event is passed to the guard and the action.
+    using event_argument_type
+        = typename fsm11_detail::get_event_argument_type<options>::type;
+    using action_type = std::function<void(event_argument_type)>;
+    using guard_type = std::function<bool(event_argument_type)>;
 
     //! \brief Creates a transition.
     //!
@@ -730,12 +909,31 @@ public:
           m_target(rhs.m_target),
           m_nextInSourceState{nullptr},
           m_nextInEnabledSet{nullptr},
-          m_guard{std::forward<TGuard>(rhs.m_guard)},
-          m_action{std::forward<TAction>(rhs.m_action)},
-          m_event{std::forward<TEvent>(rhs.m_event)},
+          m_guard{fsm11_detail::make_event_function<
+                      guard_type, event_argument_type,
+                      typename fsm11_detail::specified_event_type<TEvent>::type>(
+                          std::forward<TGuard>(rhs.m_guard))},
+          m_action{fsm11_detail::make_event_function<
+                       action_type, event_argument_type,
+                       typename fsm11_detail::specified_event_type<TEvent>::type>(
+                           std::forward<TAction>(rhs.m_action))},
+          m_event(fsm11_detail::make_transition_event<event_type>(
+                      std::forward<TEvent>(rhs.m_event),
+                      fsm11_detail::is_timeout<TEvent>())),
           m_eventless(false),
-          m_isExternal(rhs.m_isExternal)
+          m_isExternal(rhs.m_isExternal),
+          m_domain(nullptr),
+          m_cacheGeneration(0),
+          m_firstEntryState(0),
+          m_lastEntryState(0),
+          m_hasStaticEntrySet(false),
+          m_hasTimeout(fsm11_detail::is_timeout<TEvent>::value),
+          m_timeout(timeoutOf(rhs.m_event)),
+          m_timeoutGeneration(0)
     {
+        static_assert(!fsm11_detail::is_timeout<TEvent>::value
+                      || options::timer_service_enable,
+                      "Timeout transitions require the timer service");
     }
 
     //! \brief Creates a transition.
@@ -753,7 +951,15 @@ public:
           m_action{std::forward<TAction>(rhs.m_action)},
           m_event(),
           m_eventless(true),
-          m_isExternal(rhs.m_isExternal)
+          m_isExternal(rhs.m_isExternal),
+          m_domain(nullptr),
+          m_cacheGeneration(0),
+          m_firstEntryState(0),
+          m_lastEntryState(0),
+          m_hasStaticEntrySet(false),
+          m_hasTimeout(false),
+          m_timeout(0),
+          m_timeoutGeneration(0)
     {
     }
 
@@ -792,6 +998,22 @@ public:
         return m_eventless;
     }
 
+    //! \brief Checks if the transition is a timeout transition.
+    //!
+    //! Returns \p true, if this transition has been created with after().
+    bool hasTimeout() const noexcept
+    {
+        return m_hasTimeout;
+    }
+
+    //! \brief Returns the timeout.
+    //!
+    //! Returns the time after which a timeout transition is triggered.
+    std::chrono::nanoseconds timeout() const noexcept
+    {
+        return m_timeout;
+    }
+
     //! \brief Checks if the transition is external.
     //!
     //! Returns \p true, if this transition is an external one.
@@ -842,12 +1064,46 @@ private:
     bool m_eventless;
     bool m_isExternal;
 
+    //! The cached transition domain and entry set. They are valid as long
+    //! as the cache generation equals the generation of the state table.
+    state_type* m_domain;
+    std::uint32_t m_cacheGeneration;
+    //! The range of the static entry set in the dispatcher's pool.
+    std::uint32_t m_firstEntryState;
+    std::uint32_t m_lastEntryState;
+    //! Set if the entry set does not depend on history states.
+    bool m_hasStaticEntrySet;
+
+    //! Set if the transition is triggered by a timeout.
+    bool m_hasTimeout;
+    std::chrono::nanoseconds m_timeout;
+    //! The timer, which is armed while the source state is active.
+    TimerHandle m_timeoutTimer;
+    //! Incremented whenever the timer is armed or cancelled. An expired
+    //! timer, whose generation differs, is outdated.
+    std::uint32_t m_timeoutGeneration;
+
+    template <typename TEvent>
+    static std::chrono::nanoseconds timeoutOf(const TEvent&) noexcept
+    {
+        return std::chrono::nanoseconds(0);
+    }
+
+    static std::chrono::nanoseconds timeoutOf(
+            const fsm11_detail::Timeout& timeout) noexcept
+    {
+        return timeout.delay;
+    }
+
 
     friend state_type;
     friend TStateMachine;
 
     template <typename TDerived>
     friend class fsm11_detail::EventDispatcherBase;
+
+    template <typename TDerived>
+    friend class fsm11_detail::WithTimerService;
 };
 
 //! \brief Names an event in a transition specification.
@@ -858,6 +1114,38 @@ fsm11_detail::Event<TEvent&&> event(TEvent&& ev) noexcept
     return fsm11_detail::Event<TEvent&&>(std::forward<TEvent>(ev));
 }
 
+//! \brief Names an event type in a transition specification.
+//!
+//! The transition is triggered by every event of type \p TType. This
+//! requires that the event type of the state machine is a VariantEvent
+//! (see EventTypes).
+template <typename TType>
+inline
+fsm11_detail::Event<const eventType_t<TType>&> event() noexcept
+{
+    return fsm11_detail::Event<const eventType_t<TType>&>(
+                eventType_t<TType>::instance);
+}
+
+//! \brief Creates a timeout transition.
+//!
+//! The transition is triggered, when its source state has been active for
+//! the given \p delay. The timer is armed when the source state is entered
+//! and cancelled when it is left. The guard, the action and the entry and
+//! exit functions receive a default-constructed event. This requires the
+//! timer service (see TimerServiceEnable).
+//! \code
+//! sm += a + after(std::chrono::milliseconds(250)) > b;
+//! \endcode
+template <typename TRep, typename TPeriod>
+inline
+fsm11_detail::TimeoutEvent after(
+        const std::chrono::duration<TRep, TPeriod>& delay) noexcept
+{
+    return fsm11_detail::TimeoutEvent(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(delay));
+}
+
 //! A tag to create eventless transitions.
 constexpr fsm11_detail::NoEvent noEvent = fsm11_detail::NoEvent();
 
@@ -0,0 +1,400 @@
+/*******************************************************************************
+  fsm11 - A C++ library for finite state machines
+
+  Copyright (c) 2015-2016, Manuel Freiberger
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  - Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+  - Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#ifndef FSM11_VARIANTEVENT_HPP
+#define FSM11_VARIANTEVENT_HPP
+
+#include "statemachine_fwd.hpp"
+#include "detail/meta.hpp"
+
+#ifdef FSM11_USE_WEOS
+#include <weos/type_traits.hpp>
+#include <weos/utility.hpp>
+#else
+#include <type_traits>
+#include <utility>
+#endif // FSM11_USE_WEOS
+
+#include <cstddef>
+#include <new>
+
+namespace fsm11
+{
+
+//! \brief A type-tag naming an alternative of a VariantEvent.
+//!
+//! The tag is created by <tt>event<TType>()</tt> and specifies a transition,
+//! which is triggered by every event of type \p TType regardless of its
+//! payload.
+template <typename TType>
+struct eventType_t
+{
+    //! The transition specification refers to this instance.
+    static const eventType_t instance;
+};
+
+template <typename TType>
+const eventType_t<TType> eventType_t<TType>::instance = eventType_t<TType>();
+
+namespace fsm11_detail
+{
+
+//! Determines the position of \p TType in the list \p TTypes. If the type
+//! is not in the list, the value equals the length of the list.
+template <typename TType, typename... TTypes>
+struct index_of;
+
+template <typename TType>
+struct index_of<TType> : std::integral_constant<std::size_t, 0>
+{
+};
+
+template <typename TType, typename... TTail>
+struct index_of<TType, TType, TTail...>
+        : std::integral_constant<std::size_t, 0>
+{
+};
+
+template <typename TType, typename THead, typename... TTail>
+struct index_of<TType, THead, TTail...>
+        : std::integral_constant<std::size_t,
+                                 1 + index_of<TType, TTail...>::value>
+{
+};
+
+template <std::size_t... TValues>
+struct static_max;
+
+template <std::size_t TValue>
+struct static_max<TValue> : std::integral_constant<std::size_t, TValue>
+{
+};
+
+template <std::size_t THead, std::size_t... TTail>
+struct static_max<THead, TTail...>
+        : std::integral_constant<std::size_t,
+                                 (THead > static_max<TTail...>::value)
+                                 ? THead : static_max<TTail...>::value>
+{
+};
+
+} // namespace fsm11_detail
+
+// ----=====================================================================----
+//     VariantEvent
+// ----=====================================================================----
+
+//! \brief An event from a closed set of event types.
+//!
+//! A VariantEvent holds an event of one of the types \p TTypes. It is the
+//! event type of a state machine, which has been configured with the
+//! EventTypes option:
+//! \code
+//! using StateMachine_t = StateMachine<
+//!                            EventTypes<Start, Data, Stop>,
+//!                            EventListType<std::deque<VariantEvent<Start, Data, Stop>>>>;
+//! \endcode
+//! Transitions are keyed by the index of the alternative, either by naming
+//! only the type with <tt>event<Data>()</tt> or by passing an event value
+//! as in <tt>event(Data{...})</tt>. The payload of the trigger event is
+//! never compared. The transitions of a state are looked up in a jump
+//! table indexed by the alternative. Guards and actions, which take the
+//! concrete type, e.g. <tt>[](const Data& data) { ... }</tt>, receive the
+//! payload of the trigger event.
+//!
+//! A default-constructed VariantEvent is empty. The empty event is passed to
+//! the entry and exit functions of states, whenever a configuration change
+//! is not caused by an event.
+template <typename... TTypes>
+class VariantEvent
+{
+    static_assert(sizeof...(TTypes) > 0,
+                  "A VariantEvent needs at least one alternative.");
+
+public:
+    //! The index of the empty event.
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    //! The number of alternatives.
+    static constexpr std::size_t size = sizeof...(TTypes);
+
+    //! Returns the index of the alternative \p TType.
+    template <typename TType>
+    static constexpr std::size_t indexOf() noexcept
+    {
+        return fsm11_detail::index_of<TType, TTypes...>::value;
+    }
+
+    //! Creates an empty event.
+    VariantEvent() noexcept
+        : m_index(npos),
+          m_hasValue(false)
+    {
+    }
+
+    //! Creates an event holding the given \p value.
+    template <typename TType,
+              typename TDecayed = typename std::decay<TType>::type,
+              typename = typename std::enable_if<
+                             (fsm11_detail::index_of<TDecayed, TTypes...>::value
+                              < sizeof...(TTypes))>::type>
+    VariantEvent(TType&& value)
+        : m_index(npos),
+          m_hasValue(false)
+    {
+        ::new (&m_storage) TDecayed(std::forward<TType>(value));
+        m_index = indexOf<TDecayed>();
+        m_hasValue = true;
+    }
+
+    //! Creates an event without payload, which only names the alternative
+    //! \p TType. This is used for transitions created by
+    //! <tt>event<TType>()</tt>.
+    template <typename TType>
+    VariantEvent(const eventType_t<TType>&) noexcept
+        : m_index(indexOf<TType>()),
+          m_hasValue(false)
+    {
+        static_assert(fsm11_detail::index_of<TType, TTypes...>::value
+                      < sizeof...(TTypes),
+                      "The type is not an alternative of the VariantEvent.");
+    }
+
+    VariantEvent(const VariantEvent& other)
+        : m_index(other.m_index),
+          m_hasValue(false)
+    {
+        if (other.m_hasValue)
+        {
+            copy(other.m_index, &m_storage, &other.m_storage);
+            m_hasValue = true;
+        }
+    }
+
+    VariantEvent(VariantEvent&& other)
+            noexcept(fsm11_detail::all<
+                         std::is_nothrow_move_constructible<TTypes>::value...>::value)
+        : m_index(other.m_index),
+          m_hasValue(false)
+    {
+        if (other.m_hasValue)
+        {
+            move(other.m_index, &m_storage, &other.m_storage);
+            m_hasValue = true;
+        }
+    }
+
+    ~VariantEvent()
+    {
+        reset();
+    }
+
+    //! \brief Copy-assigns an event.
+    //!
+    //! If copying the payload throws, this event is left empty.
+    VariantEvent& operator=(const VariantEvent& other)
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.m_hasValue)
+                copy(other.m_index, &m_storage, &other.m_storage);
+            m_index = other.m_index;
+            m_hasValue = other.m_hasValue;
+        }
+        return *this;
+    }
+
+    //! \brief Move-assigns an event.
+    //!
+    //! If moving the payload throws, this event is left empty.
+    VariantEvent& operator=(VariantEvent&& other)
+            noexcept(fsm11_detail::all<
+                         std::is_nothrow_move_constructible<TTypes>::value...>::value)
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.m_hasValue)
+                move(other.m_index, &m_storage, &other.m_storage);
+            m_index = other.m_index;
+            m_hasValue = other.m_hasValue;
+        }
+        return *this;
+    }
+
+    //! Returns the index of the alternative or npos for an empty event.
+    std::size_t index() const noexcept
+    {
+        return m_index;
+    }
+
+    //! Returns \p true, if the event is empty.
+    bool empty() const noexcept
+    {
+        return m_index == npos;
+    }
+
+    //! Returns \p true, if the event carries a payload. This is not the case
+    //! for an empty event and for an event, which only names an alternative.
+    bool hasValue() const noexcept
+    {
+        return m_hasValue;
+    }
+
+    //! Returns \p true, if the event is of type \p TType.
+    template <typename TType>
+    bool is() const noexcept
+    {
+        return m_index == indexOf<TType>();
+    }
+
+    //! \brief Returns the payload.
+    //!
+    //! Returns the payload of type \p TType. The event must be of this type
+    //! and carry a payload.
+    template <typename TType>
+    TType& get() noexcept
+    {
+        FSM11_ASSERT(is<TType>() && m_hasValue);
+        return *reinterpret_cast<TType*>(&m_storage);
+    }
+
+    //! \brief Returns the payload.
+    //!
+    //! Returns the payload of type \p TType. The event must be of this type
+    //! and carry a payload.
+    template <typename TType>
+    const TType& get() const noexcept
+    {
+        FSM11_ASSERT(is<TType>() && m_hasValue);
+        return *reinterpret_cast<const TType*>(&m_storage);
+    }
+
+private:
+    using storage_type = typename std::aligned_storage<
+                             fsm11_detail::static_max<sizeof(TTypes)...>::value,
+                             fsm11_detail::static_max<alignof(TTypes)...>::value
+                         >::type;
+
+    storage_type m_storage;
+    std::size_t m_index;
+    bool m_hasValue;
+
+    void reset() noexcept
+    {
+        if (m_hasValue)
+        {
+            destroy(m_index, &m_storage);
+            m_hasValue = false;
+        }
+        m_index = npos;
+    }
+
+    template <typename TType>
+    static void destroyAlternative(void* object) noexcept
+    {
+        static_cast<TType*>(object)->~TType();
+    }
+
+    template <typename TType>
+    static void copyAlternative(void* target, const void* source)
+    {
+        ::new (target) TType(*static_cast<const TType*>(source));
+    }
+
+    template <typename TType>
+    static void moveAlternative(void* target, void* source)
+    {
+        ::new (target) TType(std::move(*static_cast<TType*>(source)));
+    }
+
+    static void destroy(std::size_t index, void* object) noexcept
+    {
+        using function_type = void (*)(void*);
+        static const function_type table[] = {
+            &destroyAlternative<TTypes>...
+        };
+        table[index](object);
+    }
+
+    static void copy(std::size_t index, void* target, const void* source)
+    {
+        using function_type = void (*)(void*, const void*);
+        static const function_type table[] = {
+            &copyAlternative<TTypes>...
+        };
+        table[index](target, source);
+    }
+
+    static void move(std::size_t index, void* target, void* source)
+    {
+        using function_type = void (*)(void*, void*);
+        static const function_type table[] = {
+            &moveAlternative<TTypes>...
+        };
+        table[index](target, source);
+    }
+};
+
+template <typename... TTypes>
+constexpr std::size_t VariantEvent<TTypes...>::npos;
+
+template <typename... TTypes>
+constexpr std::size_t VariantEvent<TTypes...>::size;
+
+namespace fsm11_detail
+{
+
+template <typename TEvent>
+struct is_variant_event : std::false_type
+{
+};
+
+template <typename... TTypes>
+struct is_variant_event<VariantEvent<TTypes...>> : std::true_type
+{
+};
+
+//! Checks if \p TType is an alternative of the event type \p TEvent.
+template <typename TEvent, typename TType>
+struct is_event_alternative : std::false_type
+{
+};
+
+template <typename... TTypes, typename TType>
+struct is_event_alternative<VariantEvent<TTypes...>, TType>
+        : std::integral_constant<bool, (index_of<TType, TTypes...>::value
+                                        < sizeof...(TTypes))>
+{
+};
+
+} // namespace fsm11_detail
+} // namespace fsm11
+
+#endif // FSM11_VARIANTEVENT_HPP
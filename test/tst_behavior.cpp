@@ -778,6 +778,9 @@ SCENARIO("custom invoke behavior", "[behavior]")
                 }
             }
         }
+
+        // Leave b before it is destroyed.
+        sm.stop();
     }
 
     GIVEN ("an asynchronous FSM with a state with a custom invoke action")
@@ -995,3 +998,41 @@ SCENARIO("deep history state - WIP", "[behavior]")
         // - if transition targets a more specific state, history has no effect
     }
 }
+
+SCENARIO("internal events are raised from within the state machine",
+         "[behavior]")
+{
+    GIVEN ("a synchronous FSM which raises events in actions")
+    {
+        using StateMachine_t = fsm11::StateMachine<MultithreadingEnable<true>>;
+        using State_t = StateMachine_t::state_type;
+
+        StateMachine_t sm;
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+        TrackingState<State_t> c("c", &sm);
+        TrackingState<State_t> d("d", &sm);
+
+        sm += a + event(1) / [&](int) { sm.raise(2); } > b;
+        sm += b + noEvent > c;
+        sm += c + event(2) > d;
+        sm += c + event(3) > a;
+        sm += d + event(3) > b;
+
+        sm.start();
+
+        WHEN ("an event raises an internal event")
+        {
+            sm.addEvents({1, 3});
+            THEN ("the internal event is dispatched after the eventless "
+                  "transitions and before the next external event")
+            {
+                REQUIRE(isActive(sm, {&sm, &c}));
+                REQUIRE(b == make_tuple(2, 2, 0, 0));
+                REQUIRE(d == make_tuple(1, 1, 1, 1));
+            }
+        }
+
+        sm.stop();
+    }
+}
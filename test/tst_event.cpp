@@ -28,10 +28,12 @@
 
 #include "catch.hpp"
 
+#include "../src/functionstate.hpp"
 #include "../src/statemachine.hpp"
 #include "testutils.hpp"
 
 #include <cstring>
+#include <deque>
 #include <map>
 #include <memory>
 #include <string>
@@ -348,6 +350,180 @@ SCENARIO("strings are suitable as events", "[events]")
     }
 }
 
+struct UnhashableEvent
+{
+    UnhashableEvent(int value = 0)
+        : m_value(value)
+    {
+    }
+
+    bool operator!=(const UnhashableEvent& other) const
+    {
+        return m_value != other.m_value;
+    }
+
+    int m_value;
+};
+
+SCENARIO("transitions are looked up by their event", "[event]")
+{
+    GIVEN ("an FSM with sparse integers as events")
+    {
+        using StateMachine_t = StateMachine<EventType<int>,
+                                            EventListType<std::deque<int>>>;
+        using State_t = State<StateMachine_t>;
+
+        StateMachine_t sm;
+        State_t a("a", &sm);
+        State_t b("b", &sm);
+        State_t c("c", &sm);
+
+        sm += a + event(1000000) > b;
+        sm += a + noEvent([](int e) { return e == 7; }) > c;
+        sm += a + event(7) > b;
+        sm += a + event(-5) > c;
+        sm += a + event(8) > b;
+        sm += a + noEvent([](int e) { return e == 8 || e == 9; }) > c;
+
+        sm.start();
+
+        WHEN ("an event far away from the others is added")
+        {
+            sm.addEvent(1000000);
+
+            THEN ("the transition with this event is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+            }
+        }
+
+        WHEN ("a negative event is added")
+        {
+            sm.addEvent(-5);
+
+            THEN ("the transition with this event is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &c}));
+            }
+        }
+
+        WHEN ("an event matches an eventless transition, which has been added first")
+        {
+            sm.addEvent(7);
+
+            THEN ("the eventless transition is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &c}));
+            }
+        }
+
+        WHEN ("an event matches an eventless transition, which has been added last")
+        {
+            sm.addEvent(8);
+
+            THEN ("the transition with the event is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+            }
+        }
+
+        WHEN ("an event without transition is added")
+        {
+            sm.addEvent(9);
+
+            THEN ("the eventless transition is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &c}));
+            }
+        }
+    }
+
+    GIVEN ("an FSM with std::string as event type")
+    {
+        using StateMachine_t = StateMachine<EventType<std::string>,
+                                            EventListType<std::deque<std::string>>>;
+        using State_t = State<StateMachine_t>;
+
+        StateMachine_t sm;
+        State_t a("a", &sm);
+        State_t a1("a1", &a);
+        State_t b("b", &sm);
+        State_t c("c", &sm);
+
+        sm += a + event(std::string("go to B")) > b;
+        sm += a1 + event(std::string("go to C")) > c;
+
+        sm.start();
+
+        WHEN ("the event of the parent is added")
+        {
+            sm.addEvent("go to B");
+
+            THEN ("the parent's transition is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+            }
+        }
+
+        WHEN ("the event of the child is added")
+        {
+            sm.addEvent("go to C");
+
+            THEN ("the child's transition is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &c}));
+            }
+        }
+
+        WHEN ("an unknown event is added")
+        {
+            sm.addEvent("go to X");
+
+            THEN ("nothing happens")
+            {
+                REQUIRE(isActive(sm, {&sm, &a, &a1}));
+            }
+        }
+    }
+
+    GIVEN ("an FSM with an event type, which cannot be hashed")
+    {
+        using StateMachine_t = StateMachine<EventType<UnhashableEvent>,
+                                            EventListType<std::deque<UnhashableEvent>>>;
+        using State_t = State<StateMachine_t>;
+
+        StateMachine_t sm;
+        State_t a("a", &sm);
+        State_t b("b", &sm);
+        State_t c("c", &sm);
+
+        sm += a + event(UnhashableEvent(1)) > b;
+        sm += a + event(UnhashableEvent(2)) > c;
+
+        sm.start();
+
+        WHEN ("an event is added")
+        {
+            sm.addEvent(UnhashableEvent(2));
+
+            THEN ("the matching transition is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &c}));
+            }
+        }
+
+        WHEN ("an unknown event is added")
+        {
+            sm.addEvent(UnhashableEvent(3));
+
+            THEN ("nothing happens")
+            {
+                REQUIRE(isActive(sm, {&sm, &a}));
+            }
+        }
+    }
+}
+
 #if 0
 struct TrackingEvent
 {
@@ -388,3 +564,307 @@ SCENARIO("movable types can be used as event", "[event]")
 {
 }
 #endif
+
+struct CopyCountingEvent
+{
+    CopyCountingEvent(int id = 0)
+        : id(id)
+    {
+    }
+
+    CopyCountingEvent(const CopyCountingEvent& other)
+        : id(other.id)
+    {
+        ++numCopies;
+    }
+
+    CopyCountingEvent(CopyCountingEvent&&) = default;
+
+    CopyCountingEvent& operator=(const CopyCountingEvent& other)
+    {
+        id = other.id;
+        ++numCopies;
+        return *this;
+    }
+
+    CopyCountingEvent& operator=(CopyCountingEvent&&) = default;
+
+    bool operator==(const CopyCountingEvent& other) const
+    {
+        return id == other.id;
+    }
+
+    bool operator!=(const CopyCountingEvent& other) const
+    {
+        return id != other.id;
+    }
+
+    int id;
+    static int numCopies;
+};
+
+int CopyCountingEvent::numCopies = 0;
+
+SCENARIO("events can be passed by reference", "[event]")
+{
+    GIVEN ("an FSM which passes events by reference")
+    {
+        using StateMachine_t = StateMachine<EventType<CopyCountingEvent>,
+                                            EventListType<std::deque<CopyCountingEvent>>,
+                                            EventCallbacksEnable<true>,
+                                            PassEventsByReference<true>>;
+        using State_t = FunctionState<StateMachine_t>;
+
+        StateMachine_t sm;
+        int numCalls = 0;
+        auto handler = [&](const CopyCountingEvent&) { ++numCalls; };
+        auto guard = [&](const CopyCountingEvent&) { ++numCalls; return true; };
+        State_t a("a", entryFunction, handler, exitFunction, handler, &sm);
+        State_t b("b", entryFunction, handler, exitFunction, handler, &sm);
+
+        sm += a + event(CopyCountingEvent(1)) [guard] / handler > b;
+        sm.setEventDispatchCallback(handler);
+        sm.setEventDiscardedCallback(handler);
+        sm.start();
+
+        WHEN ("events are dispatched")
+        {
+            CopyCountingEvent::numCopies = 0;
+            numCalls = 0;
+            sm.addEvent(CopyCountingEvent(1));
+            sm.addEvent(CopyCountingEvent(2));
+
+            THEN ("the events are not copied")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+                // dispatch, guard, exit, action, entry, dispatch, discard
+                REQUIRE(numCalls == 7);
+                REQUIRE(CopyCountingEvent::numCopies == 0);
+            }
+        }
+    }
+}
+
+struct StartEvent
+{
+};
+
+struct DataEvent
+{
+    int value;
+    std::string name;
+};
+
+struct StopEvent
+{
+};
+
+SCENARIO("a closed set of types can be used as events", "[event]")
+{
+    GIVEN ("an FSM with variant events")
+    {
+        using Event_t = VariantEvent<StartEvent, DataEvent, StopEvent>;
+        using StateMachine_t = StateMachine<EventTypes<StartEvent, DataEvent, StopEvent>,
+                                            EventListType<std::deque<Event_t>>>;
+        using State_t = StateMachine_t::state_type;
+
+        StateMachine_t sm;
+        State_t idle("idle", &sm);
+        State_t running("running", &sm);
+        State_t large("large", &sm);
+
+        std::string names;
+        auto isLarge = [](const DataEvent& data) { return data.value > 10; };
+        auto addName = [&](const DataEvent& data) { names += data.name; };
+        sm += idle + event<StartEvent>() > running;
+        sm += running + event<DataEvent>() [isLarge] / addName > large;
+        sm += running + event<DataEvent>() / addName > noTarget;
+        sm += running + event(StopEvent()) > idle;
+        sm += large + event<StopEvent>() > idle;
+
+        sm.start();
+        REQUIRE(isActive(sm, {&sm, &idle}));
+
+        WHEN ("an event of another type is added")
+        {
+            sm.addEvent(DataEvent{20, "x"});
+            THEN ("no transition is triggered")
+            {
+                REQUIRE(isActive(sm, {&sm, &idle}));
+                REQUIRE(names.empty());
+            }
+        }
+
+        WHEN ("events are added")
+        {
+            sm.addEvent(StartEvent());
+            REQUIRE(isActive(sm, {&sm, &running}));
+            sm.addEvent(DataEvent{5, "a"});
+            REQUIRE(isActive(sm, {&sm, &running}));
+            sm.addEvent(DataEvent{15, "b"});
+
+            THEN ("the transitions are selected by the type of the event")
+            {
+                REQUIRE(isActive(sm, {&sm, &large}));
+                REQUIRE(names == "ab");
+                sm.addEvent(StopEvent());
+                REQUIRE(isActive(sm, {&sm, &idle}));
+            }
+        }
+    }
+}
+
+TEST_CASE("a variant event holds one alternative", "[event]")
+{
+    using Event_t = VariantEvent<int, std::string>;
+
+    Event_t empty;
+    REQUIRE(empty.empty());
+    REQUIRE(!empty.hasValue());
+    REQUIRE(empty.index() == Event_t::npos);
+
+    Event_t number(42);
+    REQUIRE(number.is<int>());
+    REQUIRE(number.index() == 0);
+    REQUIRE(number.get<int>() == 42);
+
+    Event_t text(std::string("abc"));
+    REQUIRE(text.is<std::string>());
+    REQUIRE(text.index() == 1);
+
+    Event_t copy(text);
+    REQUIRE(copy.get<std::string>() == "abc");
+    REQUIRE(text.get<std::string>() == "abc");
+
+    Event_t moved(std::move(copy));
+    REQUIRE(moved.get<std::string>() == "abc");
+
+    number = moved;
+    REQUIRE(number.is<std::string>());
+    REQUIRE(number.get<std::string>() == "abc");
+
+    moved = empty;
+    REQUIRE(moved.empty());
+
+    Event_t typeOnly(eventType_t<std::string>::instance);
+    REQUIRE(typeOnly.is<std::string>());
+    REQUIRE(!typeOnly.hasValue());
+}
+
+SCENARIO("events can be matched by their prefix", "[event]")
+{
+    GIVEN ("an FSM with hierarchical event matching")
+    {
+        using StateMachine_t = StateMachine<EventType<std::string>,
+                                            EventListType<std::deque<std::string>>,
+                                            HierarchicalEventMatching<true>>;
+        using State_t = StateMachine_t::state_type;
+
+        StateMachine_t sm;
+        State_t idle("idle", &sm);
+        State_t tcp("tcp", &sm);
+        State_t reset("reset", &sm);
+        State_t other("other", &sm);
+
+        std::string log;
+        sm += idle + event(std::string("net.tcp.reset")) > reset;
+        sm += idle + event(std::string("net.tcp.*")) > tcp;
+        sm += idle + event(std::string("*")) / [&](std::string ev) {
+                                                   log += ev + ";"; } > noTarget;
+        sm += tcp + event(std::string("net")) > idle;
+        sm += reset + event(std::string("net.tcp")) > idle;
+        sm += other + event(std::string("x")) > idle;
+
+        sm.start();
+
+        WHEN ("an event matches the full descriptor")
+        {
+            sm.addEvent("net.tcp.reset");
+            THEN ("the first matching transition is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &reset}));
+            }
+        }
+
+        WHEN ("an event extends a descriptor")
+        {
+            sm.addEvent("net.tcp.open.passive");
+            THEN ("the prefix matches")
+            {
+                REQUIRE(isActive(sm, {&sm, &tcp}));
+                sm.addEvent("net.udp");
+                REQUIRE(isActive(sm, {&sm, &idle}));
+            }
+        }
+
+        WHEN ("an event shares only characters with a descriptor")
+        {
+            sm.addEvent("net.tcpip");
+            sm.addEvent("net");
+            sm.addEvent("netx.tcp");
+            THEN ("only complete tokens match")
+            {
+                REQUIRE(isActive(sm, {&sm, &idle}));
+                REQUIRE(log == "net.tcpip;net;netx.tcp;");
+            }
+        }
+
+        WHEN ("the descriptor equals the event")
+        {
+            sm.addEvent("net.tcp.reset");
+            sm.addEvent("net.tcp");
+            THEN ("the transition is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &idle}));
+            }
+        }
+    }
+
+    GIVEN ("an FSM with nested descriptors and eventless transitions")
+    {
+        using StateMachine_t = StateMachine<EventType<std::string>,
+                                            EventListType<std::deque<std::string>>,
+                                            HierarchicalEventMatching<true>>;
+        using State_t = StateMachine_t::state_type;
+
+        StateMachine_t sm;
+        State_t idle("idle", &sm);
+
+        std::string log;
+        auto reject = [&](char name) {
+            return [&log, name](const std::string&) {
+                log += name;
+                return false;
+            };
+        };
+        sm += idle + event(std::string("net.tcp.reset")) [reject('a')] > noTarget;
+        sm += idle + noEvent(reject('b')) > noTarget;
+        sm += idle + event(std::string("net")) [reject('c')] > noTarget;
+        sm += idle + event(std::string("net.tcp")) [reject('d')] > noTarget;
+        sm += idle + event(std::string("*")) [reject('e')] > noTarget;
+        sm += idle + noEvent(reject('f')) > noTarget;
+        sm += idle + event(std::string("net.udp")) [reject('g')] > noTarget;
+        sm += idle + event(std::string("net.tcp.reset")) [reject('h')] > noTarget;
+
+        sm.start();
+        log.clear();
+
+        WHEN ("an event matches descriptors at several levels")
+        {
+            sm.addEvent("net.tcp.reset.now");
+            THEN ("the candidates are checked in the order of their addition")
+            {
+                REQUIRE(log.find("abcdefh") == 0);
+            }
+        }
+
+        WHEN ("an event matches only the wildcard")
+        {
+            sm.addEvent("disk");
+            THEN ("the wildcard is merged with the eventless transitions")
+            {
+                REQUIRE(log.find("bef") == 0);
+            }
+        }
+    }
+}
@@ -28,10 +28,14 @@
 
 #include "catch.hpp"
 
+#include "../src/eventlist.hpp"
 #include "../src/statemachine.hpp"
 #include "testutils.hpp"
 
+#include <future>
 #include <queue>
+#include <thread>
+#include <vector>
 
 using namespace fsm11;
 
@@ -102,6 +106,91 @@ SCENARIO("default event list has FIFO semantic", "[eventlist]")
     }
 }
 
+SCENARIO("events can be added in batches", "[eventlist]")
+{
+    GIVEN ("a synchronous FSM")
+    {
+        using StateMachine_t = StateMachine<>;
+        using State_t = State<StateMachine_t>;
+
+        StateMachine_t sm;
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+        TrackingState<State_t> c("c", &sm);
+
+        sm += a + event(1) > b;
+        sm += b + event(2) > c;
+
+        sm.start();
+
+        WHEN ("an initializer list of events is added")
+        {
+            sm.addEvents({1, 2});
+
+            THEN ("the events are dispatched in order")
+            {
+                REQUIRE(isActive(sm, {&sm, &c}));
+                REQUIRE(b.entered == 1);
+                REQUIRE(b.left == 1);
+            }
+        }
+
+        WHEN ("a range of events is added")
+        {
+            std::vector<int> events{2, 1};
+            sm.addEvents(events);
+
+            THEN ("the events are dispatched in order")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+            }
+        }
+
+        WHEN ("an iterator pair is added")
+        {
+            std::vector<int> events{1, 2, 3};
+            sm.addEvents(events.begin(), events.begin() + 1);
+
+            THEN ("only the events in the range are dispatched")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+            }
+        }
+    }
+
+    GIVEN ("an asynchronous FSM")
+    {
+        using StateMachine_t = StateMachine<AsynchronousEventDispatching,
+                                            ConfigurationChangeCallbacksEnable<true>>;
+        using State_t = State<StateMachine_t>;
+
+        StateMachine_t sm;
+        ConfigurationChangeTracker<StateMachine_t> cct(sm);
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+
+        sm += a + event(1) > b;
+
+        auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+        sm.start();
+        cct.wait();
+
+        WHEN ("a batch of events is added")
+        {
+            sm.addEvents({3, 4, 1});
+            cct.wait();
+
+            THEN ("all events are dispatched")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+            }
+        }
+
+        sm.stop();
+        result.get();
+    }
+}
+
 template <typename T>
 struct PriorityQueueAdapter
         : public std::priority_queue<T, std::vector<T>, std::greater<T>>
@@ -189,3 +278,472 @@ SCENARIO("a priority queue can be used as event list", "[eventlist]")
         }
     }
 }
+
+SCENARIO("a lock-free queue can be used as event list", "[eventlist]")
+{
+    GIVEN ("a lock-free event queue")
+    {
+        LockFreeEventQueue<int, 4> queue;
+
+        THEN ("it is empty")
+        {
+            REQUIRE(queue.empty());
+        }
+
+        WHEN ("events are pushed until it is full")
+        {
+            for (int event = 1; event <= 4; ++event)
+                REQUIRE(queue.push_back(event));
+            int overflow = 5;
+
+            THEN ("further pushes fail")
+            {
+                REQUIRE(!queue.tryPush(overflow));
+                REQUIRE(!queue.push_back(overflow));
+            }
+
+            THEN ("the events come out in FIFO order")
+            {
+                for (int event = 1; event <= 4; ++event)
+                {
+                    REQUIRE(!queue.empty());
+                    REQUIRE(queue.front() == event);
+                    queue.pop_front();
+                }
+                REQUIRE(queue.empty());
+                REQUIRE(queue.tryPush(overflow));
+            }
+        }
+    }
+
+    GIVEN ("an asynchronous FSM with multiple producers")
+    {
+        using StateMachine_t = StateMachine<
+                                   AsynchronousEventDispatching,
+                                   EventListType<LockFreeEventQueue<int, 64>>,
+                                   ConfigurationChangeCallbacksEnable<true>>;
+        using State_t = State<StateMachine_t>;
+
+        const int numProducers = 4;
+        const int numEventsPerProducer = 2000;
+
+        StateMachine_t sm;
+        ConfigurationChangeTracker<StateMachine_t> cct(sm);
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+
+        int numDispatched = 0;
+        sm += a + event(1) / [&](int) { ++numDispatched; } > noTarget;
+        sm += a + event(2) > b;
+
+        auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+        sm.start();
+        cct.wait();
+
+        WHEN ("the producers add events concurrently")
+        {
+            std::vector<std::thread> producers;
+            for (int count = 0; count < numProducers; ++count)
+            {
+                producers.emplace_back([&] {
+                    // A full queue rejects the event. Retry until the
+                    // event loop has made room.
+                    for (int idx = 0; idx < numEventsPerProducer; ++idx)
+                        while (!sm.addEvent(1))
+                            std::this_thread::yield();
+                });
+            }
+            for (auto& producer : producers)
+                producer.join();
+            while (!sm.addEvent(2))
+                std::this_thread::yield();
+            cct.wait();
+
+            THEN ("every event is dispatched")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+                REQUIRE(numDispatched == numProducers * numEventsPerProducer);
+            }
+        }
+
+        sm.stop();
+        result.get();
+    }
+
+    GIVEN ("an asynchronous FSM whose action overflows the queue")
+    {
+        using StateMachine_t = StateMachine<
+                                   AsynchronousEventDispatching,
+                                   EventListType<LockFreeEventQueue<int, 4>>,
+                                   ConfigurationChangeCallbacksEnable<true>>;
+        using State_t = State<StateMachine_t>;
+
+        StateMachine_t sm;
+        ConfigurationChangeTracker<StateMachine_t> cct(sm);
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+
+        int numAccepted = 0;
+        int numDispatched = 0;
+        std::atomic_bool overflowed{false};
+        sm += a + event(1) / [&](int) {
+            for (int idx = 0; idx < 8; ++idx)
+                numAccepted += sm.addEvent(2);
+            overflowed = true;
+        } > noTarget;
+        sm += a + event(2) / [&](int) { ++numDispatched; } > noTarget;
+        sm += a + event(3) > b;
+
+        auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+        sm.start();
+        cct.wait();
+
+        WHEN ("the action adds more events than fit into the queue")
+        {
+            sm.addEvent(1);
+            while (!overflowed)
+                std::this_thread::yield();
+            while (!sm.addEvent(3))
+                std::this_thread::yield();
+            cct.wait();
+
+            THEN ("the surplus events are rejected")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+                REQUIRE(numAccepted == 4);
+                REQUIRE(numDispatched == 4);
+            }
+        }
+
+        sm.stop();
+        result.get();
+    }
+}
+
+SCENARIO("a ring buffer can be used as event list", "[eventlist]")
+{
+    GIVEN ("a ring buffer which rejects events on overflow")
+    {
+        RingBufferEventList<int, 2, EventOverflowPolicy::FailProducer> list;
+        REQUIRE(list.push_back(1));
+        REQUIRE(list.push_back(2));
+
+        WHEN ("another event is added")
+        {
+            bool accepted = list.push_back(3);
+
+            THEN ("it is rejected")
+            {
+                REQUIRE(!accepted);
+                REQUIRE(list.size() == 2);
+                REQUIRE(list.front() == 1);
+                REQUIRE(list.statistics().highWaterMark == 2);
+                REQUIRE(list.statistics().numOverflows == 1);
+                REQUIRE(list.statistics().numDropped == 1);
+            }
+        }
+
+        WHEN ("an event is removed and another one is added")
+        {
+            list.pop_front();
+            REQUIRE(list.push_back(3));
+
+            THEN ("the ring buffer wraps around")
+            {
+                REQUIRE(list.front() == 2);
+                list.pop_front();
+                REQUIRE(list.front() == 3);
+                list.pop_front();
+                REQUIRE(list.empty());
+                REQUIRE(list.statistics().numOverflows == 0);
+            }
+        }
+    }
+
+    GIVEN ("a ring buffer which drops the newest event")
+    {
+        RingBufferEventList<int, 2, EventOverflowPolicy::DropNewest> list;
+        list.push_back(1);
+        list.push_back(2);
+
+        WHEN ("another event is added")
+        {
+            bool accepted = list.push_back(3);
+
+            THEN ("the new event is dropped silently")
+            {
+                REQUIRE(accepted);
+                REQUIRE(list.size() == 2);
+                REQUIRE(list.front() == 1);
+                list.pop_front();
+                REQUIRE(list.front() == 2);
+                REQUIRE(list.statistics().numDropped == 1);
+            }
+        }
+    }
+
+    GIVEN ("a ring buffer which drops the oldest event")
+    {
+        RingBufferEventList<int, 2, EventOverflowPolicy::DropOldest> list;
+        list.push_back(1);
+        list.push_back(2);
+
+        WHEN ("another event is added")
+        {
+            bool accepted = list.push_back(3);
+
+            THEN ("the oldest event is dropped")
+            {
+                REQUIRE(accepted);
+                REQUIRE(list.size() == 2);
+                REQUIRE(list.front() == 2);
+                list.pop_front();
+                REQUIRE(list.front() == 3);
+                REQUIRE(list.statistics().numDropped == 1);
+            }
+        }
+    }
+
+    GIVEN ("a ring buffer which coalesces events")
+    {
+        RingBufferEventList<int, 2, EventOverflowPolicy::Coalesce> list;
+        list.push_back(1);
+        list.push_back(2);
+
+        WHEN ("a pending event is added again")
+        {
+            bool accepted = list.push_back(1);
+
+            THEN ("it is merged into the pending one")
+            {
+                REQUIRE(accepted);
+                REQUIRE(list.size() == 2);
+                REQUIRE(list.front() == 1);
+                list.pop_front();
+                REQUIRE(list.front() == 2);
+            }
+        }
+
+        WHEN ("a new event is added")
+        {
+            bool accepted = list.push_back(3);
+
+            THEN ("it is rejected")
+            {
+                REQUIRE(!accepted);
+                REQUIRE(list.size() == 2);
+            }
+        }
+    }
+
+    GIVEN ("a synchronous FSM")
+    {
+        using StateMachine_t = StateMachine<
+                                   EventListType<RingBufferEventList<int, 4>>>;
+        using State_t = State<StateMachine_t>;
+
+        StateMachine_t sm;
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+        TrackingState<State_t> c("c", &sm);
+
+        sm += a + event(1) > b;
+        sm += b + event(2) > c;
+
+        WHEN ("events [1, 2] are added and the FSM is started")
+        {
+            REQUIRE(sm.addEvent(1));
+            REQUIRE(sm.addEvent(2));
+            sm.start();
+
+            THEN ("the FSM goes via A and B to C")
+            {
+                REQUIRE(isActive(sm, {&sm, &c}));
+                REQUIRE(sm.eventList().empty());
+                REQUIRE(sm.eventList().statistics().highWaterMark == 2);
+            }
+        }
+    }
+
+    GIVEN ("an asynchronous FSM whose ring buffer blocks the producer")
+    {
+        using StateMachine_t = StateMachine<
+                                   AsynchronousEventDispatching,
+                                   EventListType<RingBufferEventList<int, 2>>,
+                                   ConfigurationChangeCallbacksEnable<true>>;
+        using State_t = State<StateMachine_t>;
+
+        const int numEvents = 1000;
+
+        StateMachine_t sm;
+        ConfigurationChangeTracker<StateMachine_t> cct(sm);
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+
+        int numDispatched = 0;
+        sm += a + event(1) / [&](int) { ++numDispatched; } > noTarget;
+        sm += a + event(2) > b;
+
+        auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+        sm.start();
+        cct.wait();
+
+        WHEN ("more events are added than fit into the list")
+        {
+            std::thread producer([&] {
+                for (int idx = 0; idx < numEvents; ++idx)
+                    sm.addEvent(1);
+            });
+            std::vector<int> batch(numEvents / 2, 1);
+            sm.addEvents(batch);
+            producer.join();
+            sm.addEvent(2);
+            cct.wait();
+
+            THEN ("no event is lost")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+                REQUIRE(numDispatched == numEvents + numEvents / 2);
+                REQUIRE(sm.eventList().statistics().highWaterMark <= 2);
+                REQUIRE(sm.eventList().statistics().numOverflows == 0);
+            }
+        }
+
+        sm.stop();
+        result.get();
+    }
+
+    GIVEN ("an asynchronous FSM whose action overflows a blocking ring buffer")
+    {
+        using StateMachine_t = StateMachine<
+                                   AsynchronousEventDispatching,
+                                   EventListType<RingBufferEventList<int, 4>>,
+                                   ConfigurationChangeCallbacksEnable<true>>;
+        using State_t = State<StateMachine_t>;
+
+        StateMachine_t sm;
+        ConfigurationChangeTracker<StateMachine_t> cct(sm);
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+
+        int numAccepted = 0;
+        int numDispatched = 0;
+        std::atomic_bool overflowed{false};
+        sm += a + event(1) / [&](int) {
+            for (int idx = 0; idx < 8; ++idx)
+                numAccepted += sm.addEvent(2);
+            sm.addEvents({2, 2});
+            overflowed = true;
+        } > noTarget;
+        sm += a + event(2) / [&](int) { ++numDispatched; } > noTarget;
+        sm += a + event(3) > b;
+
+        auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+        sm.start();
+        cct.wait();
+
+        WHEN ("the action adds more events than fit into the list")
+        {
+            sm.addEvent(1);
+            while (!overflowed)
+                std::this_thread::yield();
+            sm.addEvent(3);
+            cct.wait();
+
+            THEN ("the event loop is not blocked and rejects the surplus events")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+                REQUIRE(numAccepted == 4);
+                REQUIRE(numDispatched == 4);
+                REQUIRE(sm.eventList().statistics().numOverflows == 6);
+            }
+        }
+
+        sm.stop();
+        result.get();
+    }
+}
+
+SCENARIO("the event loop dispatches the events in batches", "[eventlist]")
+{
+    GIVEN ("an asynchronous FSM with a batch size of 16")
+    {
+        using StateMachine_t = StateMachine<
+                                   AsynchronousEventDispatching,
+                                   EventLoopBatchSize<16>,
+                                   ConfigurationChangeCallbacksEnable<true>>;
+        using State_t = State<StateMachine_t>;
+
+        const int numEvents = 1000;
+
+        StateMachine_t sm;
+        ConfigurationChangeTracker<StateMachine_t> cct(sm);
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+
+        std::vector<int> dispatched;
+        auto record = [&](int event) { dispatched.push_back(event); };
+        sm += a + event(1) / record > noTarget;
+        sm += a + event(2) / record > noTarget;
+        sm += a + event(3) > b;
+
+        auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+        sm.start();
+        cct.wait();
+
+        WHEN ("many events are added")
+        {
+            std::vector<int> events;
+            for (int idx = 0; idx < numEvents; ++idx)
+                events.push_back(1 + idx % 2);
+            for (int event : events)
+                sm.addEvent(event);
+            sm.addEvent(3);
+            cct.wait();
+
+            THEN ("all events are dispatched in order")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+                REQUIRE(dispatched == events);
+            }
+        }
+
+        sm.stop();
+        result.get();
+    }
+
+    GIVEN ("an asynchronous FSM with a batch size of 16 and pending events")
+    {
+        using StateMachine_t = StateMachine<
+                                   AsynchronousEventDispatching,
+                                   EventLoopBatchSize<16>>;
+        using State_t = State<StateMachine_t>;
+
+        const int numEvents = 1024;
+
+        StateMachine_t sm;
+        TrackingState<State_t> a("a", &sm);
+
+        int numDispatched = 0;
+        sm += a + event(1) / [&](int) { ++numDispatched; } > noTarget;
+
+        for (int idx = 0; idx < numEvents; ++idx)
+            sm.addEvent(1);
+
+        WHEN ("the FSM is started and stopped")
+        {
+            auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+            sm.start();
+            sm.stop();
+            result.get();
+
+            THEN ("the stop request is handled at a batch boundary")
+            {
+                REQUIRE(!sm.running());
+                REQUIRE(numDispatched % 16 == 0);
+                REQUIRE(numDispatched + sm.eventList().size()
+                        == std::size_t(numEvents));
+            }
+        }
+    }
+}
@@ -0,0 +1,302 @@
+/*******************************************************************************
+  fsm11 - A C++ library for finite state machines
+
+  Copyright (c) 2015-2016, Manuel Freiberger
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  - Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+  - Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#include "catch.hpp"
+
+#include "../src/statemachine.hpp"
+#include "testutils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace fsm11;
+
+namespace executorSM
+{
+using StateMachine_t = StateMachine<ExecutorEventDispatching>;
+using State_t = StateMachine_t::state_type;
+
+//! Sends numEvents[idx] events to the idx-th state machine and checks that
+//! every state machine dispatches its events without being run by two
+//! threads at the same time.
+void dispatchConcurrently(Executor& executor, const std::vector<int>& numEvents)
+{
+    struct Counter
+    {
+        std::atomic_bool busy{false};
+        int numDispatched{0};
+    };
+
+    std::atomic_int numDispatched{0};
+    std::atomic_int numOverlaps{0};
+    std::vector<std::unique_ptr<Counter>> counters;
+    std::vector<std::unique_ptr<State_t>> states;
+    std::vector<std::unique_ptr<StateMachine_t>> machines;
+
+    int totalEvents = 0;
+    for (auto num : numEvents)
+    {
+        totalEvents += num;
+        counters.emplace_back(new Counter);
+        machines.emplace_back(new StateMachine_t(executor));
+        states.emplace_back(new State_t("a", machines.back().get()));
+
+        auto& counter = *counters.back();
+        auto action = [&](int) {
+            if (counter.busy.exchange(true))
+                ++numOverlaps;
+            std::this_thread::yield();
+            ++counter.numDispatched;
+            counter.busy = false;
+            ++numDispatched;
+        };
+        *machines.back() += *states.back() + event(1) / action > *states.back();
+        machines.back()->start();
+    }
+
+    // Interleave the events of the state machines.
+    for (int cnt = 0; cnt < totalEvents; ++cnt)
+    {
+        bool added = false;
+        for (std::size_t idx = 0; idx < machines.size(); ++idx)
+        {
+            if (cnt < numEvents[idx])
+            {
+                machines[idx]->addEvent(1);
+                added = true;
+            }
+        }
+        if (!added)
+            break;
+    }
+
+    while (numDispatched != totalEvents)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    REQUIRE(numOverlaps == 0);
+    for (std::size_t idx = 0; idx < machines.size(); ++idx)
+        REQUIRE(counters[idx]->numDispatched == numEvents[idx]);
+
+    // The state machines are stopped by the destructor, while the
+    // executor is still running.
+    machines.clear();
+}
+
+} // namespace executorSM
+
+
+TEST_CASE("a reactor serves state machines round-robin", "[executor]")
+{
+    using namespace executorSM;
+
+    ReactorExecutor reactor;
+    std::vector<std::pair<int, int>> dispatched;
+
+    StateMachine_t sm1(reactor);
+    State_t a1("a1", &sm1);
+    sm1 += a1 + event(1) / [&](int) { dispatched.emplace_back(1, 1); } > a1;
+    sm1 += a1 + event(2) / [&](int) { dispatched.emplace_back(1, 2); } > a1;
+
+    StateMachine_t sm2(reactor);
+    State_t a2("a2", &sm2);
+    sm2 += a2 + event(1) / [&](int) { dispatched.emplace_back(2, 1); } > a2;
+    sm2 += a2 + event(2) / [&](int) { dispatched.emplace_back(2, 2); } > a2;
+
+    // Events, which are added before the start, are kept.
+    sm1.addEvents({1, 2, 1});
+    sm2.addEvents({2, 1, 2});
+    reactor.poll();
+    REQUIRE(!sm1.running());
+    REQUIRE(!sm2.running());
+    REQUIRE(dispatched.empty());
+
+    sm1.start();
+    sm2.start();
+    REQUIRE(reactor.poll() == 6);
+    REQUIRE(sm1.running());
+    REQUIRE(sm2.running());
+    REQUIRE(isActive(sm1, {&sm1, &a1}));
+    REQUIRE(isActive(sm2, {&sm2, &a2}));
+
+    std::vector<std::pair<int, int>> expected{
+        {1, 1}, {2, 2}, {1, 2}, {2, 1}, {1, 1}, {2, 2}};
+    REQUIRE(dispatched == expected);
+
+    sm1.stop();
+    sm1.addEvent(1);
+    sm2.addEvent(1);
+    reactor.poll();
+    REQUIRE(!sm1.running());
+    REQUIRE(!sm1.isActive());
+    REQUIRE(sm2.running());
+    REQUIRE(dispatched.size() == 7);
+    REQUIRE(dispatched.back() == std::make_pair(2, 1));
+
+    // Leave the states before they are destroyed.
+    sm2.stop();
+    reactor.poll();
+    REQUIRE(!sm2.isActive());
+}
+
+TEST_CASE("a reactor runs many state machines on a few threads", "[executor]")
+{
+    using namespace executorSM;
+
+    ReactorExecutor reactor;
+    std::vector<std::thread> threads;
+    for (int idx = 0; idx < 4; ++idx)
+        threads.emplace_back([&] { reactor.run(); });
+
+    dispatchConcurrently(reactor, std::vector<int>(500, 20));
+
+    reactor.exit();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+TEST_CASE("a work-stealing executor balances skewed loads", "[executor]")
+{
+    using namespace executorSM;
+
+    WorkStealingExecutor executor(4);
+    REQUIRE(executor.numWorkers() == 4);
+
+    SECTION ("few hot and many idle state machines")
+    {
+        std::vector<int> numEvents(1000, 1);
+        for (int idx = 0; idx < 1000; idx += 250)
+            numEvents[idx] = 2000;
+        dispatchConcurrently(executor, numEvents);
+    }
+
+    SECTION ("a single state machine")
+    {
+        dispatchConcurrently(executor, std::vector<int>(1, 1000));
+    }
+
+    SECTION ("state machines add events to each other")
+    {
+        // The states outlive the state machines, which leave them upon
+        // destruction.
+        State_t a1("a1");
+        State_t a2("a2");
+        StateMachine_t sm1(executor);
+        StateMachine_t sm2(executor);
+        a1.setParent(&sm1);
+        a2.setParent(&sm2);
+
+        std::atomic_int numPings{0};
+        sm1 += a1 + event(1) / [&](int) { ++numPings; sm2.addEvent(1); } > a1;
+        sm2 += a2 + event(1) / [&](int) {
+            if (++numPings < 1000)
+                sm1.addEvent(1);
+        } > a2;
+
+        sm1.start();
+        sm2.start();
+        sm1.addEvent(1);
+        while (numPings != 1000)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+TEST_CASE("a scheduled state machine is destroyed before it is executed",
+          "[executor]")
+{
+    using namespace executorSM;
+
+    SECTION ("the reactor is not polled")
+    {
+        ReactorExecutor reactor;
+        {
+            StateMachine_t sm(reactor);
+            sm.addEvent(1);
+        }
+        {
+            StateMachine_t sm(reactor);
+            sm.start();
+            sm.addEvent(1);
+        }
+        REQUIRE(reactor.poll() == 0);
+    }
+
+    SECTION ("the reactor has been exited")
+    {
+        ReactorExecutor reactor;
+        reactor.exit();
+        StateMachine_t sm1(reactor);
+        {
+            StateMachine_t sm2(reactor);
+            sm1.start();
+            sm2.start();
+        }
+        // The reactor does not run sm1 any more but it is still scheduled.
+        REQUIRE(!sm1.running());
+    }
+
+    SECTION ("the reactor is destroyed first")
+    {
+        std::unique_ptr<ReactorExecutor> reactor(new ReactorExecutor);
+        StateMachine_t sm(*reactor);
+        sm.start();
+        reactor.reset();
+        REQUIRE(!sm.running());
+    }
+
+    SECTION ("the only worker is busy")
+    {
+        WorkStealingExecutor executor(1);
+
+        std::atomic_bool entered{false};
+        std::atomic_bool release{false};
+        State_t a1("a1");
+        StateMachine_t sm1(executor);
+        a1.setParent(&sm1);
+        sm1 += a1 + event(1) / [&](int) {
+            entered = true;
+            while (!release)
+                std::this_thread::yield();
+        } > a1;
+        sm1.start();
+        sm1.addEvent(1);
+        while (!entered)
+            std::this_thread::yield();
+
+        // sm2 is queued behind sm1 and cancelled upon destruction.
+        {
+            StateMachine_t sm2(executor);
+            sm2.start();
+        }
+
+        release = true;
+    }
+}
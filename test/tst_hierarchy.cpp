@@ -30,6 +30,9 @@
 
 #include "../src/statemachine.hpp"
 
+#include <memory>
+#include <vector>
+
 using namespace fsm11;
 
 using StateMachine_t = fsm11::StateMachine<>;
@@ -101,3 +104,59 @@ TEST_CASE("least common ancestor", "[state]")
     REQUIRE(findLeastCommonProperAncestor(&x, &c1) == nullptr);
     REQUIRE(findLeastCommonProperAncestor(&c1, &x) == nullptr);
 }
+
+namespace
+{
+
+// Reference implementations, which follow the parent links.
+bool referenceIsAncestor(const State_t* ancestor, const State_t* descendant)
+{
+    for (; descendant; descendant = descendant->parent())
+    {
+        if (descendant == ancestor)
+            return true;
+    }
+    return false;
+}
+
+State_t* referenceLeastCommonProperAncestor(State_t* state1, State_t* state2)
+{
+    while ((state1 = state1->parent()) != nullptr)
+    {
+        if (state1 != state2 && referenceIsAncestor(state1, state2))
+            return state1;
+    }
+    return nullptr;
+}
+
+} // anonymous namespace
+
+TEST_CASE("ancestor queries use the state table of a frozen statemachine",
+          "[state]")
+{
+    StateMachine_t sm;
+    std::vector<std::unique_ptr<State_t>> states;
+
+    // Build an irregular hierarchy.
+    std::vector<State_t*> all{&sm};
+    for (int idx = 1; idx < 60; ++idx)
+    {
+        State_t* parent = all[(idx * 7) % all.size()];
+        states.emplace_back(new State_t("s", parent));
+        all.push_back(states.back().get());
+    }
+    sm.freeze();
+
+    for (State_t* s1 : all)
+    {
+        for (State_t* s2 : all)
+        {
+            bool expected = !s1->isAtomic() && referenceIsAncestor(s1, s2);
+            REQUIRE(isAncestor(s1, s2) == expected);
+            REQUIRE(isDescendant(s2, s1) == expected);
+            REQUIRE(isProperAncestor(s1, s2) == (expected && s1 != s2));
+            REQUIRE(findLeastCommonProperAncestor(s1, s2)
+                    == referenceLeastCommonProperAncestor(s1, s2));
+        }
+    }
+}
@@ -170,6 +170,190 @@ TEST_CASE("start an empty asynchronous statemachine", "[statemachine]")
     }
 }
 
+TEST_CASE("a synchronous statemachine is running in the configuration change callback",
+          "[statemachine]")
+{
+    using StateMachine_t = StateMachine<ConfigurationChangeCallbacksEnable<true>>;
+    using State_t = StateMachine_t::state_type;
+
+    StateMachine_t sm;
+    State_t a("a", &sm);
+    State_t b("b", &sm);
+    sm += a + event(1) > b;
+
+    std::vector<bool> runningInCallback;
+    int depth = 0;
+    int maxDepth = 0;
+    sm.setConfigurationChangeCallback([&] {
+        ++depth;
+        maxDepth = std::max(maxDepth, depth);
+        runningInCallback.push_back(sm.running());
+        // The event must not be dispatched from within the callback.
+        if (runningInCallback.size() == 1)
+            sm.addEvent(1);
+        --depth;
+    });
+
+    sm.start();
+    REQUIRE(sm.isActive(b));
+    REQUIRE(runningInCallback.size() == 2);
+    REQUIRE(runningInCallback[0]);
+    REQUIRE(runningInCallback[1]);
+    REQUIRE(maxDepth == 1);
+
+    sm.stop();
+    REQUIRE(runningInCallback.size() == 3);
+    REQUIRE(!runningInCallback[2]);
+}
+
+TEST_CASE("an asynchronous statemachine is running in the configuration change callback",
+          "[statemachine]")
+{
+    using namespace asyncSM;
+
+    std::mutex mutex;
+    std::vector<bool> runningInCallback;
+    std::condition_variable cv;
+
+    StateMachine_t sm;
+    sm.setConfigurationChangeCallback([&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        runningInCallback.push_back(sm.running());
+        cv.notify_all();
+    });
+
+    auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+    sm.start();
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return runningInCallback.size() == 1; });
+    REQUIRE(runningInCallback[0]);
+    lock.unlock();
+
+    sm.stop();
+    result.get();
+    REQUIRE(runningInCallback.size() == 2);
+    REQUIRE(!runningInCallback[1]);
+}
+
+TEST_CASE("a persistent event loop survives a stop", "[statemachine]")
+{
+    using StateMachine_t = StateMachine<AsynchronousEventDispatching,
+                                        ConfigurationChangeCallbacksEnable<true>,
+                                        PersistentEventLoop<true>>;
+
+    std::mutex mutex;
+    bool configurationChanged = false;
+    std::condition_variable cv;
+
+    auto waitForConfigurationChange = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return configurationChanged; });
+        configurationChanged = false;
+    };
+
+    StateMachine_t sm;
+    sm.setConfigurationChangeCallback([&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        configurationChanged = true;
+        cv.notify_all();
+    });
+
+    // A single thread runs the event loop for all start/stop cycles.
+    auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+    for (int cnt = 0; cnt < 3; ++cnt)
+    {
+        sm.start();
+        waitForConfigurationChange();
+        REQUIRE(sm.running());
+        REQUIRE(sm.isActive());
+        REQUIRE(sm.numConfigurationChanges() == 2 * cnt + 1);
+        sm.stop();
+        waitForConfigurationChange();
+        REQUIRE(!sm.running());
+        REQUIRE(!sm.isActive());
+        REQUIRE(sm.numConfigurationChanges() == 2 * cnt + 2);
+        REQUIRE(result.wait_for(std::chrono::milliseconds(0))
+                == std::future_status::timeout);
+    }
+
+    SECTION ("the event loop is exited in the stopped state")
+    {
+        sm.exitEventLoop();
+        result.get();
+        REQUIRE(!sm.running());
+    }
+
+    SECTION ("the event loop is exited in the running state")
+    {
+        sm.start();
+        waitForConfigurationChange();
+        sm.exitEventLoop();
+        result.get();
+        REQUIRE(!sm.running());
+        REQUIRE(!sm.isActive());
+    }
+}
+
+TEST_CASE("a persistent event loop restarts after a stop and a start",
+          "[statemachine]")
+{
+    using StateMachine_t = StateMachine<AsynchronousEventDispatching,
+                                        ConfigurationChangeCallbacksEnable<true>,
+                                        PersistentEventLoop<true>>;
+
+    std::mutex mutex;
+    int numConfigurationChanges = 0;
+    std::condition_variable cv;
+
+    auto waitForConfigurationChanges = [&] (int count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return numConfigurationChanges == count; });
+    };
+
+    StateMachine_t sm;
+    sm.setConfigurationChangeCallback([&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        ++numConfigurationChanges;
+        cv.notify_all();
+    });
+
+    auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+
+    SECTION ("the state machine is running")
+    {
+        sm.start();
+        waitForConfigurationChanges(1);
+        for (int cnt = 0; cnt < 100; ++cnt)
+        {
+            sm.stop();
+            sm.start();
+            // The state machine is left and entered again.
+            waitForConfigurationChanges(2 * cnt + 3);
+            REQUIRE(sm.running());
+            REQUIRE(sm.isActive());
+        }
+    }
+
+    SECTION ("the state machine is stopped")
+    {
+        for (int cnt = 0; cnt < 100; ++cnt)
+        {
+            sm.stop();
+            sm.start();
+            waitForConfigurationChanges(2 * cnt + 1);
+            REQUIRE(sm.running());
+            REQUIRE(sm.isActive());
+            sm.stop();
+            waitForConfigurationChanges(2 * cnt + 2);
+            REQUIRE(!sm.running());
+        }
+    }
+
+    sm.exitEventLoop();
+    result.get();
+    REQUIRE(numConfigurationChanges % 2 == 0);
+}
+
 TEST_CASE("an asynchronous statemachine is stopped upon destruction",
           "[statemachine]")
 {
@@ -397,3 +581,90 @@ TEST_CASE("subclassing a state machine", "[statemachine]")
     d.addEvent(1);
     REQUIRE(d.numActions == 1);
 }
+
+TEST_CASE("a frozen statemachine picks up hierarchy changes", "[statemachine]")
+{
+    using namespace syncSM;
+
+    StateMachine_t sm;
+    State_t a("a", &sm);
+    State_t a1("a1", &a);
+    State_t a2("a2", &a);
+    State_t b("b", &sm);
+    // These states are attached in the sections below. They have to outlive
+    // the sections because the state machine visits them upon destruction.
+    State_t a11("a11");
+    State_t b1("b1");
+    State_t b2("b2");
+
+    sm += a1 + event(1) > a2;
+    sm.freeze();
+
+    sm.start();
+    REQUIRE(sm.isActive(a1));
+
+    SECTION("a transition is added after freezing")
+    {
+        sm += a2 + event(2) > b;
+        sm.addEvent(1);
+        sm.addEvent(2);
+        REQUIRE(sm.isActive(b));
+        REQUIRE(!sm.isActive(a));
+    }
+
+    SECTION("an eventless transition is added after freezing")
+    {
+        sm += a2 + noEvent > b;
+        sm.addEvent(1);
+        REQUIRE(sm.isActive(b));
+        REQUIRE(!sm.isActive(a));
+    }
+
+    SECTION("a state is added after freezing")
+    {
+        b1.setParent(&b);
+        sm += a2 + event(2) > b;
+        sm.addEvent(1);
+        sm.addEvent(2);
+        REQUIRE(sm.isActive(b));
+        REQUIRE(sm.isActive(b1));
+        sm.stop();
+    }
+
+    SECTION("the child mode is changed after freezing")
+    {
+        sm.stop();
+        a.setChildMode(ChildMode::Parallel);
+        sm.start();
+        REQUIRE(sm.areAllActive(a, a1, a2));
+    }
+
+    SECTION("the initial state is changed after freezing")
+    {
+        b1.setParent(&b);
+        b2.setParent(&b);
+        sm += a1 + event(2) > b;
+        sm += b + event(3) > a1;
+
+        sm.addEvent(2);
+        REQUIRE(sm.isActive(b1));
+        sm.addEvent(3);
+
+        b.setInitialState(&b2);
+        sm.addEvent(2);
+        REQUIRE(sm.isActive(b2));
+        REQUIRE(!sm.isActive(b1));
+        sm.stop();
+    }
+
+    SECTION("a child is added to an active state")
+    {
+        // The active state a1 is not atomic any more but its child has not
+        // been entered. Its transitions must still be considered.
+        a11.setParent(&a1);
+        sm.addEvent(1);
+        REQUIRE(sm.isActive(a2));
+        REQUIRE(!sm.isActive(a1));
+        REQUIRE(!sm.isActive(a11));
+    }
+}
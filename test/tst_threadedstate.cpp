@@ -31,7 +31,9 @@
 #include "../src/threadedstate.hpp"
 #include "../src/statemachine.hpp"
 
+#include <atomic>
 #include <condition_variable>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -288,3 +290,124 @@ SCENARIO("throwing an exception in a threaded state", "[threadedstate]")
         }
     }
 }
+
+//! A state, whose invoke action registers an exit callback.
+class CallbackState : public syncSM::State_t
+{
+public:
+    enum Mode
+    {
+        //! Blocks until the callback has been executed.
+        CancelBlockingCall,
+        //! Registers the callback after the exit has been requested.
+        RegisterLate,
+        //! Unregisters the callback before the exit is requested.
+        Unregister
+    };
+
+    CallbackState(const char* name, Mode mode,
+                  fsm11::State<syncSM::StateMachine_t>* parent)
+        : syncSM::State_t(name, parent),
+          m_mode(mode)
+    {
+    }
+
+    virtual void invoke(fsm11::ExitRequest& request) override
+    {
+        switch (m_mode)
+        {
+        case CancelBlockingCall:
+        {
+            std::promise<void> cancelled;
+            ExitCallback<> callback(request, [&] {
+                callbackThread = std::this_thread::get_id();
+                ++numCallbacks;
+                cancelled.set_value();
+            });
+            invoked = true;
+            // Simulates a blocking call, which is cancelled by the callback.
+            cancelled.get_future().wait();
+            break;
+        }
+
+        case RegisterLate:
+        {
+            invoked = true;
+            request.wait();
+            ExitCallback<> callback(request, [&] {
+                callbackThread = std::this_thread::get_id();
+                ++numCallbacks;
+            });
+            break;
+        }
+
+        case Unregister:
+        {
+            {
+                ExitCallback<> callback(request, [&] { ++numCallbacks; });
+            }
+            invoked = true;
+            request.wait();
+            break;
+        }
+        }
+    }
+
+    std::atomic_bool invoked{false};
+    std::atomic_int numCallbacks{0};
+    std::thread::id callbackThread;
+
+private:
+    Mode m_mode;
+};
+
+TEST_CASE("exit callbacks are executed upon an exit request", "[threadedstate]")
+{
+    using namespace syncSM;
+
+    SECTION ("a callback cancels a blocking invoke action")
+    {
+        StateMachine_t sm;
+        CallbackState s1("s1", CallbackState::CancelBlockingCall, &sm);
+
+        for (int cnt = 0; cnt < 3; ++cnt)
+        {
+            sm.start();
+            while (!s1.invoked)
+                std::this_thread::yield();
+            sm.stop();
+            s1.invoked = false;
+
+            // The callback runs in the thread, which leaves the state.
+            REQUIRE(s1.numCallbacks == cnt + 1);
+            REQUIRE(s1.callbackThread == std::this_thread::get_id());
+        }
+    }
+
+    SECTION ("a late callback is executed immediately")
+    {
+        StateMachine_t sm;
+        CallbackState s1("s1", CallbackState::RegisterLate, &sm);
+
+        sm.start();
+        while (!s1.invoked)
+            std::this_thread::yield();
+        sm.stop();
+
+        REQUIRE(s1.numCallbacks == 1);
+        REQUIRE(s1.callbackThread != std::this_thread::get_id());
+    }
+
+    SECTION ("an unregistered callback is not executed")
+    {
+        StateMachine_t sm;
+        CallbackState s1("s1", CallbackState::Unregister, &sm);
+
+        sm.start();
+        while (!s1.invoked)
+            std::this_thread::yield();
+        sm.stop();
+
+        REQUIRE(s1.numCallbacks == 0);
+    }
+}
@@ -34,7 +34,11 @@
 
 #include "testutils.hpp"
 
+#include <atomic>
+#include <future>
+#include <memory>
 #include <utility>
+#include <vector>
 
 using namespace fsm11;
 
@@ -84,6 +88,59 @@ std::mutex TestState<T>::m_mutex;
 template <typename T>
 std::set<std::thread::id> TestState<T>::m_idSet;
 
+//! An invoke action, which blocks until a gate is opened.
+class BlockingJob : public fsm11_detail::ThreadedStateBase
+{
+public:
+    explicit
+    BlockingJob(std::shared_future<void> gate)
+        : m_gate(gate)
+    {
+    }
+
+    virtual void invoke(fsm11::ExitRequest&) override
+    {
+        started = true;
+        m_gate.wait();
+    }
+
+    //! Waits until the job has completed.
+    void join()
+    {
+        m_invokeHandle.join();
+    }
+
+    //! Returns true, if the job has completed.
+    bool ready() const
+    {
+        return m_invokeHandle.ready();
+    }
+
+    std::atomic_bool started{false};
+
+private:
+    std::shared_future<void> m_gate;
+};
+
+//! A state, whose invoke action runs until the state is left.
+template <typename TBaseState>
+class WaitingState : public TBaseState
+{
+public:
+    using TBaseState::TBaseState;
+
+    virtual void invoke(fsm11::ExitRequest& exitRequest) override
+    {
+        ++numInvoked;
+        exitRequest.wait();
+    }
+
+    static std::atomic_int numInvoked;
+};
+
+template <typename T>
+std::atomic_int WaitingState<T>::numInvoked{0};
+
 
 TEST_CASE("thread pool construction and moving", "[threadpool]")
 {
@@ -283,3 +340,191 @@ TEST_CASE("the thread pool throws an exception on underflow", "[threadpool]")
         }
     }
 }
+
+TEST_CASE("an elastic thread pool grows and shrinks", "[threadpool]")
+{
+    using namespace std;
+
+    ElasticThreadPool<1, 3> pool(chrono::milliseconds(20));
+    REQUIRE(pool.numWorkers() == 1);
+
+    promise<void> gate;
+    shared_future<void> opened = gate.get_future().share();
+    vector<unique_ptr<BlockingJob>> jobs;
+    for (int idx = 0; idx < 4; ++idx)
+    {
+        jobs.emplace_back(new BlockingJob(opened));
+        pool.enqueue(*jobs.back());
+    }
+
+    // The pool grows up to its maximum size and queues the fourth job.
+    REQUIRE(pool.numWorkers() == 3);
+    this_thread::sleep_for(chrono::milliseconds(20));
+    REQUIRE(!jobs[3]->ready());
+    REQUIRE(!jobs[3]->started);
+
+    SECTION ("a queued job is executed when a worker becomes idle")
+    {
+        gate.set_value();
+        for (auto& job : jobs)
+            job->join();
+        REQUIRE(jobs[3]->started);
+    }
+
+    SECTION ("a queued job can be cancelled")
+    {
+        pool.cancel(*jobs[3]);
+        REQUIRE(jobs[3]->ready());
+        gate.set_value();
+        for (auto& job : jobs)
+            job->join();
+        REQUIRE(!jobs[3]->started);
+    }
+
+    // The idle workers in excess of the minimum size terminate.
+    for (int cnt = 0; cnt < 500 && pool.numWorkers() > 1; ++cnt)
+        this_thread::sleep_for(chrono::milliseconds(10));
+    REQUIRE(pool.numWorkers() == 1);
+
+    // A moved pool keeps its workers.
+    ElasticThreadPool<1, 3> other(std::move(pool));
+    REQUIRE(other.numWorkers() == 1);
+}
+
+TEST_CASE("an elastic thread pool queues instead of throwing on underflow",
+          "[threadpool]")
+{
+    using StateMachine_t = StateMachine<ThreadPoolEnable<true, 1, 2>>;
+    using ThreadPool_t = StateMachine_t::thread_pool_type;
+    using State_t = ThreadedState<StateMachine_t>;
+
+    REQUIRE((std::is_same<ThreadPool_t, ElasticThreadPool<1, 2>>::value));
+
+    StateMachine_t sm;
+    WaitingState<State_t> a("a", &sm);
+    WaitingState<State_t> b("b", &a);
+    WaitingState<State_t> c("c", &b);
+    a.numInvoked = 0;
+
+    // The invoke action of c is queued because the workers are busy with
+    // a and b.
+    sm.start();
+    REQUIRE(sm.isActive(c));
+    for (int cnt = 0; cnt < 500 && a.numInvoked < 2; ++cnt)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(a.numInvoked == 2);
+
+    // The queued invoke action is removed when c is left. Otherwise, the
+    // state machine would wait for a worker forever.
+    sm.stop();
+    REQUIRE(!sm.isActive());
+    REQUIRE(a.numInvoked == 2);
+}
+
+TEST_CASE("a thread pool is shared by many state machines", "[threadpool]")
+{
+    using StateMachine_t = StateMachine<ThreadPoolEnable<true, 1, 2>>;
+    using ThreadPool_t = StateMachine_t::thread_pool_type;
+    using State_t = ThreadedState<StateMachine_t>;
+
+    const int numMachines = 20;
+
+    // The states have to outlive the state machines.
+    std::vector<std::unique_ptr<TestState<State_t>>> states;
+
+    auto run = [&](std::vector<std::unique_ptr<StateMachine_t>>& machines) {
+        for (auto& sm : machines)
+            states.emplace_back(new TestState<State_t>("a", sm.get()));
+
+        TestState<State_t>::resetNumThreads();
+        for (auto& sm : machines)
+            sm->start();
+
+        // The invoke actions are queued until a worker becomes idle.
+        auto allInvoked = [&] {
+            for (auto& state : states)
+                if (state->threadId() == std::thread::id())
+                    return false;
+            return true;
+        };
+        for (int cnt = 0; cnt < 500 && !allInvoked(); ++cnt)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        REQUIRE(allInvoked());
+
+        for (auto& sm : machines)
+            sm->stop();
+        // The invoke actions of all state machines are run in the
+        // workers of the shared pool.
+        REQUIRE(TestState<State_t>::numThreads() <= 2);
+    };
+
+    SECTION ("the pool is passed by reference")
+    {
+        ThreadPool_t pool;
+        std::vector<std::unique_ptr<StateMachine_t>> machines;
+        for (int idx = 0; idx < numMachines; ++idx)
+            machines.emplace_back(new StateMachine_t(pool));
+        run(machines);
+    }
+
+    SECTION ("the ownership of the pool is shared")
+    {
+        auto pool = std::make_shared<ThreadPool_t>();
+        std::weak_ptr<ThreadPool_t> observer = pool;
+        std::vector<std::unique_ptr<StateMachine_t>> machines;
+        for (int idx = 0; idx < numMachines; ++idx)
+            machines.emplace_back(new StateMachine_t(pool));
+        pool.reset();
+        run(machines);
+
+        // The last state machine releases the pool.
+        REQUIRE(!observer.expired());
+        machines.clear();
+        REQUIRE(observer.expired());
+    }
+}
+
+TEST_CASE("an exception thrown by an invoke action is passed to the joiner",
+          "[threadpool]")
+{
+    using namespace std;
+
+    class ThrowingJob : public fsm11_detail::ThreadedStateBase
+    {
+    public:
+        virtual void invoke(fsm11::ExitRequest&) override
+        {
+            throw 42;
+        }
+
+        void join()
+        {
+            m_invokeHandle.join();
+        }
+    };
+
+    ThrowingJob job;
+
+    SECTION ("fixed-size pool")
+    {
+        ThreadPool<1> pool;
+        for (int cnt = 0; cnt < 3; ++cnt)
+        {
+            pool.enqueue(job);
+            REQUIRE_THROWS_AS(job.join(), int);
+        }
+    }
+
+    SECTION ("elastic pool")
+    {
+        ElasticThreadPool<0, 1> pool;
+        for (int cnt = 0; cnt < 3; ++cnt)
+        {
+            pool.enqueue(job);
+            REQUIRE_THROWS_AS(job.join(), int);
+        }
+    }
+
+    // A joined handle does not rethrow a second time.
+    job.join();
+}
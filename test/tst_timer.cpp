@@ -0,0 +1,411 @@
+/*******************************************************************************
+  fsm11 - A C++ library for finite state machines
+
+  Copyright (c) 2015-2016, Manuel Freiberger
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  - Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+  - Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#include "catch.hpp"
+
+#include "../src/statemachine.hpp"
+#include "testutils.hpp"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+using namespace fsm11;
+using namespace std::chrono;
+
+
+TEST_CASE("a timer wheel expires timers in order", "[timer]")
+{
+    fsm11_detail::TimerWheel<int> wheel;
+    std::vector<int> expired;
+    auto collect = [&](int payload) { expired.push_back(payload); };
+
+    SECTION ("timers in all levels expire at their tick")
+    {
+        const std::uint64_t ticks[] = {
+            1, 255, 256, 257, 65535, 65536, 70000, 1u << 24, (1u << 24) + 1,
+            std::uint64_t(1) << 32, (std::uint64_t(1) << 32) + 300};
+        for (int idx = 10; idx >= 0; --idx)
+            wheel.schedule(ticks[idx], idx);
+        REQUIRE(wheel.size() == 11);
+
+        for (int idx = 0; idx < 11; ++idx)
+        {
+            wheel.advance(ticks[idx] - 1, collect);
+            REQUIRE(int(expired.size()) == idx);
+            wheel.advance(ticks[idx], collect);
+            REQUIRE(int(expired.size()) == idx + 1);
+            REQUIRE(expired.back() == idx);
+        }
+        REQUIRE(wheel.empty());
+    }
+
+    SECTION ("timers with the same expiry keep their order")
+    {
+        wheel.advance(1000, collect);
+        for (int idx = 0; idx < 5; ++idx)
+            wheel.schedule(100000, idx);
+        wheel.advance(200000, collect);
+        REQUIRE(expired == std::vector<int>({0, 1, 2, 3, 4}));
+    }
+
+    SECTION ("a timer in the past expires with the next tick")
+    {
+        wheel.advance(10, collect);
+        wheel.schedule(5, 1);
+        REQUIRE(wheel.nextTick() == 11);
+        wheel.advance(11, collect);
+        REQUIRE(expired == std::vector<int>({1}));
+    }
+
+    SECTION ("a cancelled timer does not expire")
+    {
+        auto h1 = wheel.schedule(300, 1);
+        auto h2 = wheel.schedule(300, 2);
+        REQUIRE(wheel.cancel(h1));
+        REQUIRE(!wheel.cancel(h1));
+        REQUIRE(wheel.size() == 1);
+
+        wheel.advance(1000, collect);
+        REQUIRE(expired == std::vector<int>({2}));
+        REQUIRE(!wheel.cancel(h2));
+
+        // The node is re-used but the old handle stays invalid.
+        auto h3 = wheel.schedule(2000, 3);
+        REQUIRE(!wheel.cancel(h2));
+        REQUIRE(wheel.cancel(h3));
+        REQUIRE(!wheel.cancel(TimerHandle()));
+    }
+}
+
+SCENARIO("a synchronous state machine is driven by processTimers()", "[timer]")
+{
+    using StateMachine_t = StateMachine<TimerServiceEnable<true>>;
+    using State_t = State<StateMachine_t>;
+    using time_point = StateMachine_t::time_point;
+
+    GIVEN ("a synchronous FSM with timers")
+    {
+        StateMachine_t sm;
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+        TrackingState<State_t> c("c", &sm);
+
+        sm += a + event(1) > b;
+        sm += b + event(2) > c;
+        sm.start();
+
+        time_point now = steady_clock::now();
+        REQUIRE(sm.nextTimerExpiry() == time_point::max());
+
+        WHEN ("events are sent at different times")
+        {
+            sm.sendAt(2, now + milliseconds(500));
+            sm.sendAt(1, now + milliseconds(100));
+
+            THEN ("they are dispatched when their time has come")
+            {
+                REQUIRE(sm.nextTimerExpiry() <= now + milliseconds(101));
+                REQUIRE(sm.processTimers(now) == 0);
+                REQUIRE(isActive(sm, {&sm, &a}));
+                REQUIRE(sm.processTimers(now + milliseconds(101)) == 1);
+                REQUIRE(isActive(sm, {&sm, &b}));
+                REQUIRE(sm.processTimers(now + milliseconds(499)) == 0);
+                REQUIRE(sm.processTimers(now + milliseconds(501)) == 1);
+                REQUIRE(isActive(sm, {&sm, &c}));
+                REQUIRE(sm.nextTimerExpiry() == time_point::max());
+            }
+        }
+
+        WHEN ("a timer is cancelled")
+        {
+            auto handle = sm.sendAfter(1, milliseconds(100));
+            REQUIRE(sm.cancelTimer(handle));
+
+            THEN ("its event is not dispatched")
+            {
+                REQUIRE(sm.processTimers(now + seconds(1)) == 0);
+                REQUIRE(isActive(sm, {&sm, &a}));
+                REQUIRE(!sm.cancelTimer(handle));
+            }
+        }
+    }
+}
+
+SCENARIO("an asynchronous state machine processes timers in the event loop",
+         "[timer]")
+{
+    using StateMachine_t = StateMachine<AsynchronousEventDispatching,
+                                        ConfigurationChangeCallbacksEnable<true>,
+                                        TimerServiceEnable<true>>;
+    using State_t = State<StateMachine_t>;
+
+    GIVEN ("an asynchronous FSM with timers")
+    {
+        StateMachine_t sm;
+        ConfigurationChangeTracker<StateMachine_t> cct(sm);
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+        TrackingState<State_t> c("c", &sm);
+
+        sm += a + event(1) > b;
+        sm += b + event(2) > c;
+        sm += a + event(3) > c;
+
+        auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+        sm.start();
+        cct.wait();
+
+        WHEN ("an event is sent after a delay")
+        {
+            auto start = steady_clock::now();
+            sm.sendAfter(2, milliseconds(40));
+            sm.sendAfter(1, milliseconds(20));
+            cct.wait();
+            cct.wait();
+
+            THEN ("the events are dispatched after the delay")
+            {
+                REQUIRE(steady_clock::now() - start >= milliseconds(40));
+                REQUIRE(isActive(sm, {&sm, &c}));
+            }
+        }
+
+        WHEN ("a timer is cancelled")
+        {
+            auto handle = sm.sendAfter(3, milliseconds(20));
+            REQUIRE(sm.cancelTimer(handle));
+            sm.sendAfter(1, milliseconds(40));
+            cct.wait();
+
+            THEN ("only the other timer fires")
+            {
+                REQUIRE(isActive(sm, {&sm, &b}));
+            }
+        }
+
+        sm.stop();
+        result.get();
+    }
+}
+
+SCENARIO("timeout transitions are armed on entry and cancelled on exit",
+         "[timer]")
+{
+    using StateMachine_t = StateMachine<TimerServiceEnable<true>>;
+    using State_t = State<StateMachine_t>;
+
+    GIVEN ("a synchronous FSM with a timeout transition")
+    {
+        StateMachine_t sm;
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+        TrackingState<State_t> c("c", &sm);
+
+        sm += a + after(milliseconds(100)) > c;
+        sm += a + event(1) > b;
+        sm += b + event(2) > a;
+
+        sm.start();
+        auto now = steady_clock::now();
+        REQUIRE(isActive(sm, {&sm, &a}));
+
+        WHEN ("the timeout elapses")
+        {
+            THEN ("the timeout transition is triggered")
+            {
+                REQUIRE(sm.processTimers(now + milliseconds(50)) == 0);
+                REQUIRE(isActive(sm, {&sm, &a}));
+                REQUIRE(sm.processTimers(now + milliseconds(102)) == 1);
+                REQUIRE(isActive(sm, {&sm, &c}));
+            }
+        }
+
+        WHEN ("the source state is left before the timeout")
+        {
+            sm.addEvent(1);
+            REQUIRE(isActive(sm, {&sm, &b}));
+
+            THEN ("the timer is cancelled")
+            {
+                REQUIRE(sm.nextTimerExpiry() == StateMachine_t::time_point::max());
+                REQUIRE(sm.processTimers(now + seconds(1)) == 0);
+                REQUIRE(isActive(sm, {&sm, &b}));
+            }
+        }
+
+        WHEN ("the source state is re-entered")
+        {
+            sm.addEvent(1);
+            sm.processTimers(now + milliseconds(80));
+            sm.addEvent(2);
+            auto reentered = steady_clock::now();
+
+            THEN ("the timer is armed again")
+            {
+                REQUIRE(sm.processTimers(reentered + milliseconds(50)) == 0);
+                REQUIRE(isActive(sm, {&sm, &a}));
+                REQUIRE(sm.processTimers(reentered + milliseconds(102)) == 1);
+                REQUIRE(isActive(sm, {&sm, &c}));
+            }
+        }
+
+        WHEN ("a default-constructed event is added")
+        {
+            sm.addEvent(0);
+
+            THEN ("it does not trigger the timeout transition")
+            {
+                REQUIRE(isActive(sm, {&sm, &a}));
+            }
+        }
+
+        sm.stop();
+    }
+
+    GIVEN ("a targetless timeout transition with a guard and an action")
+    {
+        StateMachine_t sm;
+        TrackingState<State_t> a("a", &sm);
+
+        bool enabled = false;
+        int numTimeouts = 0;
+        auto guard = [&](int) { return enabled; };
+        sm += a + after(milliseconds(10))(guard) / [&](int) { ++numTimeouts; }
+                > noTarget;
+
+        sm.start();
+        auto now = steady_clock::now();
+
+        WHEN ("the guard holds")
+        {
+            enabled = true;
+            sm.processTimers(now + seconds(1));
+            sm.processTimers(now + seconds(2));
+
+            THEN ("the action is executed once")
+            {
+                REQUIRE(numTimeouts == 1);
+                REQUIRE(a.entered == 1);
+            }
+        }
+
+        WHEN ("the guard does not hold")
+        {
+            sm.processTimers(now + seconds(1));
+
+            THEN ("the action is not executed")
+            {
+                REQUIRE(numTimeouts == 0);
+            }
+        }
+
+        sm.stop();
+    }
+
+    GIVEN ("many concurrent timeouts")
+    {
+        const int numRegions = 1000;
+
+        StateMachine_t sm;
+        State_t p("p", &sm);
+        p.setChildMode(ChildMode::Parallel);
+        std::vector<std::unique_ptr<State_t>> states;
+        for (int idx = 0; idx < numRegions; ++idx)
+        {
+            State_t* region = new State_t("region", &p);
+            State_t* x = new State_t("x", region);
+            State_t* y = new State_t("y", region);
+            states.emplace_back(y);
+            states.emplace_back(x);
+            states.emplace_back(region);
+            sm += *x + after(milliseconds(idx + 1)) > *y;
+        }
+
+        sm.start();
+        auto now = steady_clock::now();
+
+        WHEN ("all timeouts elapse")
+        {
+            std::size_t numExpired = sm.processTimers(now + milliseconds(numRegions / 2));
+            numExpired += sm.processTimers(now + seconds(2));
+
+            THEN ("every region is in its second state")
+            {
+                REQUIRE(numExpired == std::size_t(numRegions));
+                for (int idx = 0; idx < numRegions; ++idx)
+                    REQUIRE(sm.isActive(*states[3 * idx]));
+            }
+        }
+
+        sm.stop();
+    }
+}
+
+SCENARIO("an asynchronous state machine triggers timeout transitions",
+         "[timer]")
+{
+    using StateMachine_t = StateMachine<AsynchronousEventDispatching,
+                                        ConfigurationChangeCallbacksEnable<true>,
+                                        TimerServiceEnable<true>>;
+    using State_t = State<StateMachine_t>;
+
+    GIVEN ("an asynchronous FSM with a chain of timeouts")
+    {
+        StateMachine_t sm;
+        ConfigurationChangeTracker<StateMachine_t> cct(sm);
+        TrackingState<State_t> a("a", &sm);
+        TrackingState<State_t> b("b", &sm);
+        TrackingState<State_t> c("c", &sm);
+
+        sm += a + after(milliseconds(20)) > b;
+        sm += b + after(milliseconds(20)) > c;
+
+        auto start = steady_clock::now();
+        auto result = std::async(std::launch::async, [&] { sm.eventLoop(); });
+        sm.start();
+        cct.wait();
+
+        WHEN ("the timeouts elapse")
+        {
+            cct.wait();
+            cct.wait();
+
+            THEN ("the FSM has moved along the chain")
+            {
+                REQUIRE(steady_clock::now() - start >= milliseconds(40));
+                REQUIRE(isActive(sm, {&sm, &c}));
+                REQUIRE(b == std::make_tuple(1, 1, 1, 1));
+            }
+        }
+
+        sm.stop();
+        result.get();
+    }
+}
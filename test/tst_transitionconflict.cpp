@@ -178,3 +178,60 @@ SCENARIO("transition conflict exception", "[conflicts]")
         }
     }
 }
+
+SCENARIO("transitions in parallel regions", "[conflicts]")
+{
+    GIVEN ("a state machine with a parallel state")
+    {
+        using StateMachine_t = StateMachine<
+                                   TransitionConflictPolicy<InvokeCallback>>;
+        using State_t = State<StateMachine_t>;
+        using Transition_t = Transition<StateMachine_t>;
+
+        StateMachine_t sm;
+        State_t p("p", &sm);
+        p.setChildMode(ChildMode::Parallel);
+        State_t r1("r1", &p);
+        State_t a1("a1", &r1);
+        State_t a2("a2", &r1);
+        State_t r2("r2", &p);
+        State_t b1("b1", &r2);
+        State_t b2("b2", &r2);
+        State_t x("x", &sm);
+
+        sm += a1 + event(1) > a2;
+        sm += b1 + event(1) > b2;
+        Transition_t* t1 = sm += a1 + event(2) > a2;
+        Transition_t* t2 = sm += b1 + event(2) > x;
+
+        int conflicts = 0;
+        sm.setTransitionConflictCallback([&](Transition_t* a, Transition_t* b) {
+            ++conflicts;
+            REQUIRE(a == t1);
+            REQUIRE(b == t2);
+        });
+
+        sm.start();
+        REQUIRE(isActive(sm, {&sm, &p, &r1, &a1, &r2, &b1}));
+
+        WHEN ("the exit sets of the transitions are disjoint")
+        {
+            sm.addEvent(1);
+            THEN ("both transitions are taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &p, &r1, &a2, &r2, &b2}));
+                REQUIRE(conflicts == 0);
+            }
+        }
+
+        WHEN ("one transition leaves the parallel state")
+        {
+            sm.addEvent(2);
+            THEN ("the conflict is reported and the first transition is taken")
+            {
+                REQUIRE(isActive(sm, {&sm, &p, &r1, &a2, &r2, &b1}));
+                REQUIRE(conflicts == 1);
+            }
+        }
+    }
+}
@@ -47,6 +47,7 @@ SOURCES += \
     tst_eventcallback.cpp \
     tst_eventlist.cpp \
     tst_exceptions.cpp \
+    tst_executor.cpp \
     tst_functionstate.cpp \
     tst_hierarchy.cpp \
     tst_iteration.cpp \
@@ -56,12 +57,15 @@ SOURCES += \
     tst_statemachine.cpp \
     tst_threadedstate.cpp \
     tst_threadpool.cpp \
+    tst_timer.cpp \
     tst_transition.cpp \
     tst_transitionconflict.cpp \
     tst_transitionconflictcallback.cpp
 
 HEADERS += \
     ../src/error.hpp \
+    ../src/eventlist.hpp \
+    ../src/executor.hpp \
     ../src/exitrequest.hpp \
     ../src/functionstate.hpp \
     ../src/historystate.hpp \
@@ -73,14 +77,20 @@ HEADERS += \
     ../src/threadedstate.hpp \
     ../src/threadpool.hpp \
     ../src/transition.hpp \
+    ../src/variantevent.hpp \
     ../src/detail/callbacks.hpp \
     ../src/detail/capturestorage.hpp \
     ../src/detail/eventdispatcher.hpp \
+    ../src/detail/eventindex.hpp \
+    ../src/detail/futex.hpp \
     ../src/detail/meta.hpp \
     ../src/detail/multithreading.hpp \
     ../src/detail/scopeguard.hpp \
+    ../src/detail/statetable.hpp \
     ../src/detail/threadedstatebase.hpp \
-    ../src/detail/threadpool.hpp
+    ../src/detail/threadpool.hpp \
+    ../src/detail/timerservice.hpp \
+    ../src/detail/timerwheel.hpp
 
 HEADERS += catch.hpp \
            fsm11_user_config.hpp \